@@ -0,0 +1,118 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "Benchmark.h"
+
+#include "mythril/CTX.h"
+#include "mythril/RenderGraphBuilder.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mythril::bench {
+	namespace {
+		constexpr uint32_t kNumPasses = 400;
+		constexpr uint32_t kNumTextures = 32;
+		constexpr uint32_t kNumBuffers = 16;
+		constexpr uint32_t kNumWarmupFrames = 16;
+		constexpr uint32_t kNumFrames = 500;
+
+		struct BarrierScene {
+			std::vector<Texture> textures;
+			std::vector<Buffer> buffers;
+			Texture target;
+			RenderGraph graph;
+		};
+
+		// compute passes ping-ponging over a small pool of textures and buffers, so nearly every pass needs barriers
+		// a condition, even one that never skips, makes the frame unpredictable and keeps the graph on the per-frame trackers
+		void BuildScene(CTX& ctx, BarrierScene& scene, bool isPredictable) {
+			scene.textures.reserve(kNumTextures);
+			for (uint32_t i = 0; i < kNumTextures; ++i) {
+				scene.textures.push_back(ctx.createTexture({
+				        .dimension = {64, 64, 1},
+				        .format = VK_FORMAT_R8G8B8A8_UNORM,
+				        .usage = TextureUsageBits_Storage | TextureUsageBits_Sampled,
+				        .debugName = "Benchmark Texture",
+				}));
+				scene.graph.markOutput(scene.textures.back());
+			}
+			scene.buffers.reserve(kNumBuffers);
+			for (uint32_t i = 0; i < kNumBuffers; ++i) {
+				scene.buffers.push_back(ctx.createBuffer({
+				        .size = 4096,
+				        .usage = BufferUsageBits_Storage,
+				        .storage = StorageType::Device,
+				        .debugName = "Benchmark Buffer",
+				}));
+			}
+			scene.target = ctx.createTexture({
+			        .dimension = {64, 64, 1},
+			        .format = VK_FORMAT_R8G8B8A8_UNORM,
+			        .usage = TextureUsageBits_Attachment | TextureUsageBits_Sampled,
+			        .debugName = "Benchmark Target",
+			});
+			scene.graph.markOutput(scene.target);
+
+			for (uint32_t i = 0; i < kNumPasses; ++i) {
+				const std::string name = "compute " + std::to_string(i);
+				scene.graph.addComputePass(name.c_str())
+				        .dependency(scene.textures[i % kNumTextures], Layout::GENERAL)
+				        .dependency(scene.textures[(i + 1) % kNumTextures], Layout::READ)
+				        .dependency(scene.textures[(i + 7) % kNumTextures], Layout::READ)
+				        .dependency(scene.buffers[i % kNumBuffers], BufferAccess::ShaderReadWrite)
+				        .dependency(scene.buffers[(i + 3) % kNumBuffers], BufferAccess::ShaderRead)
+				        .execute([](CommandBuffer&) {});
+			}
+			// an empty condition is the same as none at all
+			std::function<bool()> condition;
+			if (!isPredictable)
+				condition = [] { return true; };
+			scene.graph.addGraphicsPass("composite")
+			        .attachment({
+			                .texDesc = scene.target,
+			                .clearValue = ClearValue::color(0.f, 0.f, 0.f, 1.f),
+			                .loadOp = LoadOp::CLEAR,
+			                .storeOp = StoreOp::STORE,
+			        })
+			        .dependency(scene.textures[0], Layout::READ)
+			        .condition(std::move(condition))
+			        .execute([](CommandBuffer&) {});
+			scene.graph.compile(ctx);
+		}
+
+		void RunScene(CTX& ctx, bool isPredictable, const char* variant) {
+			BarrierScene scene;
+			BuildScene(ctx, scene, isPredictable);
+			// only execute is timed, acquiring and submitting the command buffer is the same either way
+			std::chrono::duration<double, std::nano> elapsed{};
+			uint64_t numAllocations = 0;
+			for (uint32_t frame = 0; frame < kNumWarmupFrames + kNumFrames; ++frame) {
+				CommandBuffer& cmd = ctx.acquireCommand(CommandBuffer::Type::Graphics);
+				const uint64_t allocationsBefore = GetNumAllocations();
+				const Clock::time_point begin = Clock::now();
+				scene.graph.execute(cmd);
+				if (frame >= kNumWarmupFrames) {
+					elapsed += Clock::now() - begin;
+					numAllocations += GetNumAllocations() - allocationsBefore;
+				}
+				ctx.submitCommand(cmd);
+			}
+			const double ns = elapsed.count() / kNumFrames;
+			PrintResult(fmt::format("{} (per frame)", variant), ns / 1000.0, "us");
+			PrintResult(fmt::format("{} (per pass)", variant), ns / (kNumPasses + 1), "ns");
+			if (IsCountingAllocations())
+				PrintResult(fmt::format("{} (heap allocations per frame)", variant), static_cast<double>(numAllocations) / kNumFrames, "");
+		}
+	} // namespace
+
+	// before/after of baking barriers at compile time
+	// the per-frame trackers are what every frame went through before the bake, and what unpredictable graphs still use
+	void RunBarrierBakeBenchmark() {
+		PrintHeader(fmt::format("RenderGraph barriers, {} passes", kNumPasses + 1));
+		CtxPtr ctx = CreateHeadlessCtx();
+		RunScene(*ctx, false, "per-frame trackers");
+		RunScene(*ctx, true, "baked at compile");
+	}
+} // namespace mythril::bench
@@ -0,0 +1,67 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+
+#pragma once
+
+#include "mythril/CTXBuilder.h"
+#include "AllocationTracker.h"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+// cpu side microbenchmarks, built with MYTH_BUILD_BENCHMARKS
+// numbers are only comparable within one run on one machine, build with CMAKE_BUILD_TYPE=Release
+namespace mythril::bench {
+	using Clock = std::chrono::steady_clock;
+
+	// runs fn untimed a few times first so caches, arenas and lazily created objects are warm
+	template<typename Fn>
+	double MeasureNs(uint32_t iterations, Fn&& fn) {
+		constexpr uint32_t kNumWarmupIterations = 8;
+		for (uint32_t i = 0; i < kNumWarmupIterations; ++i)
+			fn();
+		const Clock::time_point begin = Clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+			fn();
+		const std::chrono::duration<double, std::nano> elapsed = Clock::now() - begin;
+		return elapsed.count() / iterations;
+	}
+
+	// heap allocations so far, only counted with MYTH_ENABLE_ALLOCATION_TRACKING
+	inline bool IsCountingAllocations() {
+#ifdef MYTH_ENABLED_ALLOCATION_TRACKING
+		return true;
+#else
+		return false;
+#endif
+	}
+	inline uint64_t GetNumAllocations() {
+#ifdef MYTH_ENABLED_ALLOCATION_TRACKING
+		return GetNumHeapAllocations();
+#else
+		return 0;
+#endif
+	}
+
+	// no surface means no swapchain, validation would only measure itself
+	inline CtxPtr CreateHeadlessCtx() {
+		return CTXBuilder{}
+		        .set_vulkan_cfg({
+		                .app_name = "mythril benchmarks",
+		                .engine_name = "mythril",
+		                .enableValidation = false,
+		        })
+		        .build();
+	}
+
+	inline void PrintHeader(std::string_view name) {
+		fmt::print("\n== {} ==\n", name);
+	}
+	inline void PrintResult(std::string_view variant, double value, std::string_view unit) {
+		fmt::print("  {:<40} {:>12.2f} {}\n", variant, value, unit);
+	}
+} // namespace mythril::bench
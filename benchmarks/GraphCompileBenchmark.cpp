@@ -0,0 +1,103 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "Benchmark.h"
+
+#include "mythril/CTX.h"
+#include "mythril/RenderGraphBuilder.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mythril::bench {
+	namespace {
+		constexpr uint32_t kPassCounts[] = {1000, 5000, 10000};
+		constexpr uint32_t kNumTextures = 256;
+		constexpr uint32_t kNumBuffers = 64;
+		constexpr uint32_t kNumCompiles = 3;
+
+		enum class SharingPattern {
+			// every pass reads and writes a few resources picked at random out of small pools
+			Random,
+			// one texture written once and then read by every other pass, the case that used to scan every reader
+			FanOut,
+		};
+
+		void BuildGraph(RenderGraph& graph, const std::vector<Texture>& textures, std::vector<Buffer>& buffers, uint32_t numPasses, SharingPattern pattern) {
+			// fixed seed, every run compiles the same graphs
+			std::mt19937 rng(1234);
+			for (uint32_t i = 0; i < numPasses; ++i) {
+				const std::string name = "compute " + std::to_string(i);
+				if (pattern == SharingPattern::Random) {
+					// neighbours of a random pick, a pass never lists the same resource twice
+					const uint32_t tex = rng() % kNumTextures;
+					const uint32_t buf = rng() % kNumBuffers;
+					graph.addComputePass(name.c_str())
+					        .dependency(textures[tex], Layout::READ)
+					        .dependency(textures[(tex + 1) % kNumTextures], Layout::READ)
+					        .dependency(textures[(tex + 2) % kNumTextures], Layout::GENERAL)
+					        .dependency(buffers[buf], BufferAccess::ShaderRead)
+					        .dependency(buffers[(buf + 1) % kNumBuffers], BufferAccess::ShaderReadWrite)
+					        .execute([](CommandBuffer&) {});
+				} else if (i == 0) {
+					graph.addComputePass(name.c_str())
+					        .dependency(textures[0], Layout::GENERAL)
+					        .execute([](CommandBuffer&) {});
+				} else {
+					graph.addComputePass(name.c_str())
+					        .dependency(textures[0], Layout::READ)
+					        .dependency(textures[1 + i % (kNumTextures - 1)], Layout::GENERAL)
+					        .execute([](CommandBuffer&) {});
+				}
+			}
+		}
+
+		void RunGraphs(CTX& ctx, const std::vector<Texture>& textures, std::vector<Buffer>& buffers, SharingPattern pattern, const char* variant) {
+			for (const uint32_t numPasses: kPassCounts) {
+				RenderGraph graph;
+				for (const Texture& texture: textures)
+					graph.markOutput(texture);
+				BuildGraph(graph, textures, buffers, numPasses, pattern);
+				// the first compile creates the pools and caches every later one reuses
+				graph.compile(ctx);
+				const Clock::time_point begin = Clock::now();
+				for (uint32_t i = 0; i < kNumCompiles; ++i)
+					graph.compile(ctx);
+				const std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+				const double ms = elapsed.count() / kNumCompiles;
+				PrintResult(fmt::format("{}, {} passes (compile)", variant, numPasses), ms, "ms");
+				PrintResult(fmt::format("{}, {} passes (per pass)", variant, numPasses), ms * 1000.0 / numPasses, "us");
+			}
+		}
+	} // namespace
+
+	// compile time of large synthetic graphs, edge construction and everything walking the dag scales with them
+	// every pass writes an output so nothing gets culled
+	void RunGraphCompileBenchmark() {
+		PrintHeader("RenderGraph compile");
+		CtxPtr ctx = CreateHeadlessCtx();
+		std::vector<Texture> textures;
+		textures.reserve(kNumTextures);
+		for (uint32_t i = 0; i < kNumTextures; ++i) {
+			textures.push_back(ctx->createTexture({
+			        .dimension = {16, 16, 1},
+			        .format = VK_FORMAT_R8G8B8A8_UNORM,
+			        .usage = TextureUsageBits_Storage | TextureUsageBits_Sampled,
+			        .debugName = "Benchmark Texture",
+			}));
+		}
+		std::vector<Buffer> buffers;
+		buffers.reserve(kNumBuffers);
+		for (uint32_t i = 0; i < kNumBuffers; ++i) {
+			buffers.push_back(ctx->createBuffer({
+			        .size = 256,
+			        .usage = BufferUsageBits_Storage,
+			        .storage = StorageType::Device,
+			        .debugName = "Benchmark Buffer",
+			}));
+		}
+		RunGraphs(*ctx, textures, buffers, SharingPattern::Random, "random sharing");
+		RunGraphs(*ctx, textures, buffers, SharingPattern::FanOut, "fan-out reads");
+	}
+} // namespace mythril::bench
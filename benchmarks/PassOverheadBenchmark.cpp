@@ -0,0 +1,112 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "Benchmark.h"
+
+#include "RenderGraphInternal.h"
+#include "mythril/CTX.h"
+#include "mythril/RenderGraphBuilder.h"
+
+#include <string>
+#include <vector>
+
+namespace mythril::bench {
+	namespace {
+		constexpr uint32_t kNumPasses = 200;
+		constexpr uint32_t kNumTargets = 8;
+		constexpr uint32_t kNumWarmupFrames = 16;
+		constexpr uint32_t kNumFrames = 500;
+		constexpr uint32_t kNumIterations = 2000;
+
+		// keeps the active pass observable so neither the copy nor the pointer gets optimized away
+		volatile size_t gActivePassSink = 0;
+
+		// shaped like the passes of the graph below, a heap allocated name, a few barriers, an attachment and callbacks
+		std::vector<CompiledPass> MakeCompiledPasses() {
+			std::vector<CompiledPass> passes(kNumPasses);
+			for (uint32_t i = 0; i < kNumPasses; ++i) {
+				CompiledPass& pass = passes[i];
+				pass.name = "benchmark graphics pass " + std::to_string(i);
+				pass.passIndex = i;
+				pass.type = PassDesc::Type::Graphics;
+				pass.imageBarriers.resize(2);
+				pass.bufferBarriers.resize(1);
+				pass.executeCallback = [i](CommandBuffer&) { gActivePassSink = i; };
+				pass.colorAttachments.push_back(AttachmentInfo{.imageFormat = VK_FORMAT_R8G8B8A8_UNORM});
+				pass.formats.colorFormats[0] = VK_FORMAT_R8G8B8A8_UNORM;
+				pass.formats.numColorFormats = 1;
+				pass.attachmentImages.resize(1);
+			}
+			return passes;
+		}
+
+		// what recordPass did to hand CommandBuffer its active pass, before and after it became a pointer
+		void RunActivePassHandoff() {
+			const std::vector<CompiledPass> passes = MakeCompiledPasses();
+			CompiledPass copiedPass;
+			const double copyNs = MeasureNs(kNumIterations, [&] {
+				for (const CompiledPass& pass: passes) {
+					copiedPass = pass;
+					gActivePassSink = gActivePassSink + copiedPass.formats.numColorFormats;
+				}
+			});
+			PrintResult("copy CompiledPass (before, per pass)", copyNs / kNumPasses, "ns");
+
+			const CompiledPass* activePass = nullptr;
+			const double referenceNs = MeasureNs(kNumIterations, [&] {
+				for (const CompiledPass& pass: passes) {
+					activePass = &pass;
+					gActivePassSink = gActivePassSink + activePass->formats.numColorFormats;
+				}
+			});
+			PrintResult("reference CompiledPass (after, per pass)", referenceNs / kNumPasses, "ns");
+		}
+
+		// the whole per pass cost of execute on a graph of small graphics passes, most of which is what the handoff used to be
+		void RunGraphExecute(CTX& ctx) {
+			std::vector<Texture> targets;
+			targets.reserve(kNumTargets);
+			RenderGraph graph;
+			for (uint32_t i = 0; i < kNumTargets; ++i) {
+				targets.push_back(ctx.createTexture({
+				        .dimension = {64, 64, 1},
+				        .format = VK_FORMAT_R8G8B8A8_UNORM,
+				        .usage = TextureUsageBits_Attachment | TextureUsageBits_Sampled,
+				        .debugName = "Benchmark Target",
+				}));
+				graph.markOutput(targets.back());
+			}
+			for (uint32_t i = 0; i < kNumPasses; ++i) {
+				const std::string name = "graphics " + std::to_string(i);
+				graph.addGraphicsPass(name.c_str())
+				        .attachment({
+				                .texDesc = targets[i % kNumTargets],
+				                .loadOp = LoadOp::LOAD,
+				                .storeOp = StoreOp::STORE,
+				        })
+				        .dependency(targets[(i + 1) % kNumTargets], Layout::READ)
+				        .execute([](CommandBuffer&) {});
+			}
+			graph.compile(ctx);
+
+			std::chrono::duration<double, std::nano> elapsed{};
+			for (uint32_t frame = 0; frame < kNumWarmupFrames + kNumFrames; ++frame) {
+				CommandBuffer& cmd = ctx.acquireCommand(CommandBuffer::Type::Graphics);
+				const Clock::time_point begin = Clock::now();
+				graph.execute(cmd);
+				if (frame >= kNumWarmupFrames)
+					elapsed += Clock::now() - begin;
+				ctx.submitCommand(cmd);
+			}
+			PrintResult("graph execute (after, per pass)", elapsed.count() / kNumFrames / kNumPasses, "ns");
+		}
+	} // namespace
+
+	// per pass overhead of handing the active pass to the command buffer, the copy is what every pass paid before
+	void RunPassOverheadBenchmark() {
+		PrintHeader(fmt::format("RenderGraph per pass overhead, {} passes", kNumPasses));
+		RunActivePassHandoff();
+		CtxPtr ctx = CreateHeadlessCtx();
+		RunGraphExecute(*ctx);
+	}
+} // namespace mythril::bench
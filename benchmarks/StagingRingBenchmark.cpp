@@ -0,0 +1,187 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "Benchmark.h"
+
+#include "mythril/CTX.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace mythril::bench {
+	namespace {
+		constexpr uint32_t kNumUploads = 10000;
+		constexpr uint32_t kUploadSize = 256;
+		constexpr uint32_t kNumWarmupFrames = 8;
+		constexpr uint32_t kNumFrames = 50;
+		// the region list takes seconds a frame at this size, a few frames are enough once it is fragmented
+		constexpr uint32_t kNumLegacyWarmupFrames = 4;
+		constexpr uint32_t kNumLegacyFrames = 8;
+		// same as StagingDevice::_minBufferSize, the size the staging buffer starts out with
+		constexpr uint32_t kStagingBufferSize = 4u * 2048u * 2048u;
+		constexpr uint32_t kStagingAlignment = 16;
+		// how many frames a submit stays on the simulated gpu before its fence reads as ready
+		constexpr uint64_t kFramesInFlight = 2;
+
+		// the region list allocator StagingDevice had before the ring, fed the way stageBufferCopy and onGraphSubmit fed it
+		// staging memory is a plain vector and fences are frame numbers, so only the allocator and the memcpy are measured
+		// the real one also recorded a copy per upload and paid for isReady on real fences, this is a lower bound of its cost
+		class LegacyStagingAllocator {
+		public:
+			LegacyStagingAllocator() : _memory(kStagingBufferSize) {
+				_regions.push_back({0, kStagingBufferSize, 0, State::Free});
+			}
+
+			void stage(const void* data, uint32_t size) {
+				const uint32_t requestedAlignedSize = AlignUp(size);
+				uint32_t totalFree = 0;
+				for (const Region& region: _regions) {
+					if (isRegionFree(region))
+						totalFree += region.size;
+				}
+				if (totalFree < requestedAlignedSize)
+					waitAndReset();
+				while (size) {
+					Region desc = getNextFreeOffset(size);
+					const uint32_t chunkSize = std::min(size, desc.size);
+					std::memcpy(_memory.data() + desc.offset, data, chunkSize);
+					desc.size = chunkSize;
+					desc.state = State::Pending;
+					desc.frame = 0;
+					_regions.push_back(desc);
+					size -= chunkSize;
+					data = static_cast<const uint8_t*>(data) + chunkSize;
+				}
+			}
+			void onGraphSubmit() {
+				for (Region& region: _regions) {
+					if (region.state != State::Pending)
+						continue;
+					region.frame = _frame;
+					region.state = State::Busy;
+				}
+				_frame++;
+				_completedFrame = std::max(_completedFrame, _frame > kFramesInFlight ? _frame - kFramesInFlight : 0);
+			}
+
+		private:
+			enum class State : uint8_t {
+				Free,
+				Pending,
+				Busy
+			};
+			struct Region {
+				uint32_t offset;
+				uint32_t size;
+				uint64_t frame;
+				State state;
+			};
+
+			static uint32_t AlignUp(uint32_t size) { return (size + kStagingAlignment - 1) & ~(kStagingAlignment - 1); }
+			bool isRegionFree(const Region& region) const {
+				return region.state == State::Free || (region.state == State::Busy && region.frame < _completedFrame);
+			}
+			Region getNextFreeOffset(uint32_t size) {
+				const uint32_t requestedAlignedSize = AlignUp(size);
+				auto bestNextIt = _regions.begin();
+				for (auto it = _regions.begin(); it != _regions.end(); ++it) {
+					if (!isRegionFree(*it))
+						continue;
+					if (it->size >= requestedAlignedSize) {
+						const uint32_t unusedSize = it->size - requestedAlignedSize;
+						const uint32_t unusedOffset = it->offset + requestedAlignedSize;
+						const Region result = {it->offset, requestedAlignedSize, 0, State::Free};
+						_regions.erase(it);
+						if (unusedSize > 0)
+							_regions.insert(_regions.begin(), {unusedOffset, unusedSize, 0, State::Free});
+						return result;
+					}
+					if (it->size > bestNextIt->size)
+						bestNextIt = it;
+				}
+				if (bestNextIt != _regions.end() && isRegionFree(*bestNextIt)) {
+					const Region result = {bestNextIt->offset, bestNextIt->size, 0, State::Free};
+					_regions.erase(bestNextIt);
+					return result;
+				}
+				waitAndReset();
+				_regions.clear();
+				const uint32_t unusedSize = kStagingBufferSize > requestedAlignedSize ? kStagingBufferSize - requestedAlignedSize : 0;
+				if (unusedSize)
+					_regions.insert(_regions.begin(), {kStagingBufferSize - unusedSize, unusedSize, 0, State::Free});
+				return {0, kStagingBufferSize - unusedSize, 0, State::Free};
+			}
+			// waiting on every busy region means everything submitted so far has completed
+			void waitAndReset() {
+				_completedFrame = _frame;
+				_regions.clear();
+				_regions.push_back({0, kStagingBufferSize, 0, State::Free});
+			}
+
+			std::vector<uint8_t> _memory;
+			std::vector<Region> _regions;
+			uint64_t _frame = 0;
+			uint64_t _completedFrame = 0;
+		};
+
+		void RunLegacyAllocator(const std::vector<uint8_t>& data) {
+			LegacyStagingAllocator allocator;
+			std::chrono::duration<double, std::nano> elapsed{};
+			for (uint32_t frame = 0; frame < kNumLegacyWarmupFrames + kNumLegacyFrames; ++frame) {
+				const Clock::time_point begin = Clock::now();
+				for (uint32_t i = 0; i < kNumUploads; ++i)
+					allocator.stage(data.data() + i * kUploadSize, kUploadSize);
+				allocator.onGraphSubmit();
+				if (frame >= kNumLegacyWarmupFrames)
+					elapsed += Clock::now() - begin;
+			}
+			const double ns = elapsed.count() / kNumLegacyFrames;
+			PrintResult("region list, allocator only (per frame)", ns / 1000.0, "us");
+			PrintResult("region list, allocator only (per upload)", ns / kNumUploads, "ns");
+		}
+
+		// the ring through the public upload path, batched so a frame is one submit
+		// this includes recording the copies and submitting them, which the legacy number leaves out
+		void RunRing(CTX& ctx, const std::vector<uint8_t>& data) {
+			Buffer buffer = ctx.createBuffer({
+			        .size = static_cast<size_t>(kNumUploads) * kUploadSize,
+			        .usage = BufferUsageBits_Storage,
+			        .storage = StorageType::Device,
+			        .debugName = "Benchmark Upload Target",
+			});
+			std::chrono::duration<double, std::nano> elapsed{};
+			uint64_t numAllocations = 0;
+			SubmitHandle lastSubmit;
+			for (uint32_t frame = 0; frame < kNumWarmupFrames + kNumFrames; ++frame) {
+				const uint64_t allocationsBefore = GetNumAllocations();
+				const Clock::time_point begin = Clock::now();
+				ctx.beginUploadBatch();
+				for (uint32_t i = 0; i < kNumUploads; ++i)
+					ctx.upload(buffer.handle(), data.data() + i * kUploadSize, kUploadSize, static_cast<size_t>(i) * kUploadSize);
+				lastSubmit = ctx.flushUploadBatch();
+				if (frame >= kNumWarmupFrames) {
+					elapsed += Clock::now() - begin;
+					numAllocations += GetNumAllocations() - allocationsBefore;
+				}
+			}
+			ctx.wait(lastSubmit);
+			const double ns = elapsed.count() / kNumFrames;
+			PrintResult("ring, upload + record + submit (per frame)", ns / 1000.0, "us");
+			PrintResult("ring, upload + record + submit (per upload)", ns / kNumUploads, "ns");
+			if (IsCountingAllocations())
+				PrintResult("ring (heap allocations per frame)", static_cast<double>(numAllocations) / kNumFrames, "");
+		}
+	} // namespace
+
+	// before/after of the staging ring with many small uploads a frame
+	void RunStagingRingBenchmark() {
+		PrintHeader(fmt::format("StagingDevice, {} uploads of {} bytes per frame", kNumUploads, kUploadSize));
+		std::vector<uint8_t> data(static_cast<size_t>(kNumUploads) * kUploadSize);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<uint8_t>(i);
+		RunLegacyAllocator(data);
+		CtxPtr ctx = CreateHeadlessCtx();
+		RunRing(*ctx, data);
+	}
+} // namespace mythril::bench
@@ -0,0 +1,162 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "Benchmark.h"
+
+#include "RenderGraphInternal.h"
+#include "faststl/FrameArena.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace mythril::bench {
+	namespace {
+		constexpr uint32_t kNumMips = 12;
+		constexpr uint32_t kNumLayers = 6;
+		constexpr uint32_t kNumIterations = 20000;
+
+		// the rectangle list tracker as it was before the dense one, kept only to have something to compare against
+		class LegacyTextureStateTracker {
+		public:
+			using SubresourceEntry = TextureStateTracker::SubresourceEntry;
+
+			LegacyTextureStateTracker(uint32_t mips, uint32_t layers)
+			    : totalMips(mips), totalLayers(layers) {
+				subresourceStates.push_back({wholeResourceRange(), {}});
+			}
+			std::vector<SubresourceEntry> getOverlappingStates(const SubresourceRange& range) const {
+				std::vector<SubresourceEntry> overlappingStates;
+				for (const auto& entry: subresourceStates) {
+					if (!entry.range.overlaps(range)) continue;
+					overlappingStates.push_back({intersect(entry.range, range), entry.state});
+				}
+				return overlappingStates;
+			}
+			void setState(SubresourceRange range, const SubresourceState& state) {
+				if (range.numMips == 0 || range.numLayers == 0) {
+					range = wholeResourceRange();
+				}
+				if (range == wholeResourceRange()) {
+					subresourceStates.clear();
+					subresourceStates.push_back({range, state});
+					return;
+				}
+				std::vector<SubresourceEntry> nextStates;
+				nextStates.reserve(subresourceStates.size() + 4);
+				for (const auto& entry: subresourceStates) {
+					if (!entry.range.overlaps(range)) {
+						nextStates.push_back(entry);
+						continue;
+					}
+					appendDifference(nextStates, entry, range);
+				}
+				nextStates.push_back({range, state});
+				subresourceStates = std::move(nextStates);
+			}
+			SubresourceRange wholeResourceRange() const { return {0, totalMips, 0, totalLayers}; }
+
+		private:
+			uint32_t totalMips;
+			uint32_t totalLayers;
+
+			std::vector<SubresourceEntry> subresourceStates;
+
+			static SubresourceRange intersect(const SubresourceRange& a, const SubresourceRange& b) {
+				const uint32_t mipBegin = std::max(a.baseMip, b.baseMip);
+				const uint32_t mipEnd = std::min(a.baseMip + a.numMips, b.baseMip + b.numMips);
+				const uint32_t layerBegin = std::max(a.baseLayer, b.baseLayer);
+				const uint32_t layerEnd = std::min(a.baseLayer + a.numLayers, b.baseLayer + b.numLayers);
+				return {mipBegin, mipEnd - mipBegin, layerBegin, layerEnd - layerBegin};
+			}
+			static void appendIfValid(std::vector<SubresourceEntry>& entries, const SubresourceRange& range, const SubresourceState& state) {
+				if (range.numMips > 0 && range.numLayers > 0) {
+					entries.push_back({range, state});
+				}
+			}
+			static void appendDifference(std::vector<SubresourceEntry>& entries, const SubresourceEntry& entry, const SubresourceRange& removedRange) {
+				const SubresourceRange overlap = intersect(entry.range, removedRange);
+				const uint32_t entryMipEnd = entry.range.baseMip + entry.range.numMips;
+				const uint32_t overlapMipEnd = overlap.baseMip + overlap.numMips;
+				const uint32_t entryLayerEnd = entry.range.baseLayer + entry.range.numLayers;
+				const uint32_t overlapLayerEnd = overlap.baseLayer + overlap.numLayers;
+
+				appendIfValid(entries, {entry.range.baseMip, overlap.baseMip - entry.range.baseMip, entry.range.baseLayer, entry.range.numLayers}, entry.state);
+				appendIfValid(entries, {overlapMipEnd, entryMipEnd - overlapMipEnd, entry.range.baseLayer, entry.range.numLayers}, entry.state);
+				appendIfValid(entries, {overlap.baseMip, overlap.numMips, entry.range.baseLayer, overlap.baseLayer - entry.range.baseLayer}, entry.state);
+				appendIfValid(entries, {overlap.baseMip, overlap.numMips, overlapLayerEnd, entryLayerEnd - overlapLayerEnd}, entry.state);
+			}
+		};
+
+		constexpr SubresourceState kSampledState = {
+		        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT}};
+		constexpr SubresourceState kStorageState = {
+		        VK_IMAGE_LAYOUT_GENERAL,
+		        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT}};
+
+		// keeps the returned entries observable so the lookups are not optimized away
+		volatile size_t gNumEntriesSink = 0;
+
+		// what the frame path does per dependency, look up the old states for the barriers then record the new one
+		template<typename Tracker, typename GetStates>
+		void Transition(Tracker& tracker, const SubresourceRange& range, const SubresourceState& state, GetStates&& getStates) {
+			gNumEntriesSink = gNumEntriesSink + getStates(tracker, range).size();
+			tracker.setState(range, state);
+		}
+
+		// one frame of a mip chain generation, each pass samples mip - 1 and writes mip
+		// per face runs a pass per layer as well, which is the worst case for splitting rectangles
+		// the chain ends sampled as a whole, so the tracker collapses back to where the next frame starts
+		template<typename Tracker, typename GetStates>
+		void DownsampleFrame(Tracker& tracker, bool isPerFace, GetStates&& getStates) {
+			for (uint32_t mip = 1; mip < kNumMips; ++mip) {
+				if (isPerFace) {
+					for (uint32_t layer = 0; layer < kNumLayers; ++layer) {
+						Transition(tracker, {mip - 1, 1, layer, 1}, kSampledState, getStates);
+						Transition(tracker, {mip, 1, layer, 1}, kStorageState, getStates);
+					}
+				} else {
+					Transition(tracker, {mip - 1, 1, 0, kNumLayers}, kSampledState, getStates);
+					Transition(tracker, {mip, 1, 0, kNumLayers}, kStorageState, getStates);
+				}
+			}
+			Transition(tracker, {0, kNumMips, 0, kNumLayers}, kSampledState, getStates);
+		}
+
+		void RunPattern(bool isPerFace, const char* pattern) {
+			LegacyTextureStateTracker legacy(kNumMips, kNumLayers);
+			const double legacyNs = MeasureNs(kNumIterations, [&] {
+				DownsampleFrame(legacy, isPerFace, [](const LegacyTextureStateTracker& tracker, const SubresourceRange& range) {
+					return tracker.getOverlappingStates(range);
+				});
+			});
+			PrintResult(fmt::format("{}, rectangle list", pattern), legacyNs, "ns");
+
+			TextureStateTracker dense(kNumMips, kNumLayers);
+			const double denseNs = MeasureNs(kNumIterations, [&] {
+				DownsampleFrame(dense, isPerFace, [](const TextureStateTracker& tracker, const SubresourceRange& range) {
+					return tracker.getOverlappingStates(range);
+				});
+			});
+			PrintResult(fmt::format("{}, dense", pattern), denseNs, "ns");
+
+			// the way the frame path calls it, with the scratch vectors in the frame arena
+			TextureStateTracker denseArena(kNumMips, kNumLayers);
+			LinearArena arena;
+			const double denseArenaNs = MeasureNs(kNumIterations, [&] {
+				DownsampleFrame(denseArena, isPerFace, [&arena](const TextureStateTracker& tracker, const SubresourceRange& range) {
+					return tracker.getOverlappingStates(range, ArenaAllocator<TextureStateTracker::SubresourceEntry>(arena));
+				});
+				arena.reset();
+			});
+			PrintResult(fmt::format("{}, dense + frame arena", pattern), denseArenaNs, "ns");
+		}
+	} // namespace
+
+	// before/after of the dense texture state tracker on per-mip downsample chains of a cubemap
+	void RunTextureStateTrackerBenchmark() {
+		PrintHeader(fmt::format("TextureStateTracker, {} mips x {} layers, per frame", kNumMips, kNumLayers));
+		RunPattern(false, "all faces per mip");
+		RunPattern(true, "one face per pass");
+	}
+} // namespace mythril::bench
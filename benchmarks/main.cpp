@@ -0,0 +1,50 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "Benchmark.h"
+
+#include <fmt/format.h>
+
+#include <string_view>
+
+namespace mythril::bench {
+	void RunBarrierBakeBenchmark();
+	void RunTextureStateTrackerBenchmark();
+	void RunPassOverheadBenchmark();
+	void RunGraphCompileBenchmark();
+	void RunStagingRingBenchmark();
+} // namespace mythril::bench
+
+struct BenchmarkEntry {
+	const char* name;
+	void (*run)();
+};
+static constexpr BenchmarkEntry kBenchmarks[] = {
+        {"barriers", mythril::bench::RunBarrierBakeBenchmark},
+        {"trackers", mythril::bench::RunTextureStateTrackerBenchmark},
+        {"passes", mythril::bench::RunPassOverheadBenchmark},
+        {"compile", mythril::bench::RunGraphCompileBenchmark},
+        {"staging", mythril::bench::RunStagingRingBenchmark},
+};
+
+// runs every benchmark, or only the ones named on the command line
+int main(int argc, char** argv) {
+	bool ranAny = false;
+	for (const BenchmarkEntry& entry: kBenchmarks) {
+		bool selected = argc <= 1;
+		for (int i = 1; i < argc && !selected; ++i)
+			selected = std::string_view(argv[i]) == entry.name;
+		if (!selected)
+			continue;
+		entry.run();
+		ranAny = true;
+	}
+	if (!ranAny) {
+		fmt::print("Unknown benchmark, available ones are:");
+		for (const BenchmarkEntry& entry: kBenchmarks)
+			fmt::print(" {}", entry.name);
+		fmt::print("\n");
+		return 1;
+	}
+	return 0;
+}
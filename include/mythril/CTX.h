@@ -39,6 +39,8 @@
 #include "../../lib/CommandBuffer.h"
 #include "../../lib/Plugins.h"
 #include "../../lib/SlangCompiler.h"
+#include "../../lib/WorkerPool.h"
+#include "../../lib/faststl/FrameArena.h"
 #include "Specs.h"
 
 #include <deque>
@@ -239,7 +241,28 @@ namespace mythril {
 		void download(BufferHandle handle, void* data, size_t size, size_t offset);
 		// for textures
 		void upload(TextureHandle handle, const void* data, const TexRange& range);
-		void download(TextureHandle handle, void* data, const TexRange& range);CommandBuffer createActiveCommand(CommandBuffer::Type type);SubmitHandle submitActiveCommand(CommandBuffer&cmd);
+		void download(TextureHandle handle, void* data, const TexRange& range);
+		// uploads between these two are recorded into one command buffer with a single set of barriers instead of a submit each
+		// the returned handle is empty when nothing was uploaded, waiting on it covers every upload of the batch
+		void beginUploadBatch();
+		SubmitHandle flushUploadBatch();
+		void wait(SubmitHandle handle);
+		// same as upload() but recorded on the transfer queue and handed to the graphics queue with an ownership transfer
+		// the resource must not be used before the ticket was awaited, or isUploadReady() returned true and a frame was acquired since
+		// without a distinct transfer family these upload synchronously and return an empty ticket
+		UploadTicket uploadAsync(BufferHandle handle, const void* data, size_t size, size_t offset = 0);
+		UploadTicket uploadAsync(TextureHandle handle, const void* data, const TexRange& range);
+		bool isUploadReady(UploadTicket ticket) const;
+		// the next graphics submit waits for the upload on the gpu and acquires it, nothing blocks on the cpu
+		void awaitUpload(UploadTicket ticket);
+		// copies into the readback ring without waiting. with a command buffer open the copy is recorded after everything in it so far
+		// and retires with its submit. the result is either fetched once with fetchReadback(), or handed to the callback by the
+		// first submitCommand() after the copy retired
+		ReadbackTicket requestReadback(BufferHandle handle, size_t size, size_t offset = 0, StagingDevice::ReadbackCallback callback = {});
+		ReadbackTicket requestReadback(TextureHandle handle, const TexRange& range, StagingDevice::ReadbackCallback callback = {});
+		bool isReadbackReady(ReadbackTicket ticket) const;
+		// false while the copy is in flight, the ticket stays valid until this returned true
+		bool fetchReadback(ReadbackTicket ticket, void* outData, size_t size);CommandBuffer createActiveCommand(CommandBuffer::Type type);SubmitHandle submitActiveCommand(CommandBuffer&cmd);
 
 	public:
 		// for automatic cleanup of resources
@@ -289,13 +312,24 @@ namespace mythril {
 		// wrappers around VulkanObjects
 		// advanced functions that user will rarely need to call
 		void generateMipmaps(TextureHandle handle);
+		// false when nothing went through the staging ring, either because of null data or a mapped buffer
+		bool uploadBufferImpl(StagingDevice& staging, BufferHandle handle, const void* data, size_t size, size_t offset);
+		bool uploadTextureImpl(StagingDevice& staging, TextureHandle handle, const void* data, const TexRange& range);
+		// acquires every async upload that finished or was awaited, and makes the next graphics submit wait on them
+		void acquireAsyncUploadsImpl(VkCommandBuffer cmd);
 		TextureHandle createTextureViewImpl(TextureHandle handle, TextureViewSpec spec);
+		TextureHandle createTextureFromSpecImpl(TextureSpec spec, bool isTransient);
+		// transient textures are created without memory, the RenderGraph binds them into its aliased allocations
+		void bindTransientTextureImpl(TextureHandle handle, VmaAllocation allocation);
+		void resetTransientTextureImpl(TextureHandle handle);
 
 		// all things related to our pipeline constructions
 		PipelineCoreData buildPipelineCommonDataExceptVkPipelineImpl(const PipelineLayoutSignature& signature);
 
 		// return values from resolvings are ignored for now
-		void resolveGraphicsPipelineImpl(AllocatedGraphicsPipeline& pipeline, uint32_t viewMask);
+		// they only touch the pipeline given and the device, so compile can resolve several at once
+		// callers bump _commandEpoch once the new pipelines are in place
+		void resolveGraphicsPipelineImpl(AllocatedGraphicsPipeline& pipeline, uint32_t viewMask, const AttachmentFormats& formats);
 		void resolveComputePipelineImpl(AllocatedComputePipeline& pipeline);
 
 		// VkPipeline buildGraphicsPipelineImpl(VkPipelineLayout layout, GraphicsPipelineSpec spec);
@@ -315,11 +349,19 @@ namespace mythril {
 		        uint32_t numLayers,
 		        VkSampleCountFlagBits sampleCountFlagBits,
 		        VkComponentMapping componentMapping,
-		        VkImageCreateFlags createFlags = 0
+		        VkImageCreateFlags createFlags = 0,
+		        bool isTransient = false
 		);
+		void createTextureViewsImpl(AllocatedTexture& obj);
 
 		void checkAndUpdateBindlessDescriptorSetImpl();
 		void growBindlessDescriptorPoolImpl(uint32_t newMaxSamplerCount, uint32_t newMaxTextureCount);
+		// created on first use, only the RenderGraph records in parallel for now
+		WorkerPool& getWorkerPoolImpl();
+		// scratch memory for whatever is recorded into the current frame, reset once that frame's submit retired
+		// only the thread recording the graphics command buffer may draw from it
+		LinearArena& getFrameArenaImpl() { return _frameArenas[_frameArenaIdx]; }
+		void advanceFrameArenaImpl(SubmitHandle handle);
 
 		template<typename T>
 		constexpr PipelineCoreData& getPipelienCommonData(T handle) {
@@ -417,6 +459,13 @@ namespace mythril {
 		// bumped whenever graph-relevant resource topology changes (texture resize, swapchain recreate/destroy)
 		// RenderGraph snapshots this in compile() and re-checks it in execute() to auto-recompile when stale. one uint64 compare per frame.
 		uint64_t _resourceEpoch = 0;
+		// bumped whenever something a recorded command buffer refers to is replaced (pipelines, buffers, the bindless set)
+		// RenderGraph re-records its cached static secondaries when it changes
+		uint64_t _commandEpoch = 0;
+		static constexpr uint32_t kNumFrameArenas = 3;
+		std::array<LinearArena, kNumFrameArenas> _frameArenas;
+		std::array<SubmitHandle, kNumFrameArenas> _frameArenaSubmits = {};
+		uint32_t _frameArenaIdx = 0;
 		std::unique_ptr<ImmediateCommands> _immGraphics = nullptr;
 		// both are nullptr when we fail to get a distinct family during setup
 		std::unique_ptr<ImmediateCommands> _immAsyncCompute = nullptr;
@@ -424,6 +473,13 @@ namespace mythril {
 
 		std::unique_ptr<Swapchain> _swapchain = nullptr;
 		std::unique_ptr<StagingDevice> _staging = nullptr;
+		// records on _immAsyncTransfer, only there when it is
+		std::unique_ptr<StagingDevice> _asyncStaging = nullptr;
+		// highest ticket awaited since the last acquire
+		uint64_t _awaitedUploadValue = 0;
+		// pinned results would only get in the way of uploads, so readbacks have a ring of their own
+		std::unique_ptr<StagingDevice> _readbackStaging = nullptr;
+		std::unique_ptr<WorkerPool> _workerPool = nullptr;
 
 		Texture wrappedBackBuffer;
 		// SwapchainSpec lastSwapchainSpec;
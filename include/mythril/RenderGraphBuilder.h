@@ -10,14 +10,20 @@
 
 #include <volk.h>
 
+#include <array>
+#include <deque>
 #include <functional>
 #include <span>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
 
+// same definition as vk_mem_alloc.h, kept out of the public headers
+VK_DEFINE_HANDLE(VmaAllocation)
+
 namespace mythril {
     class RenderGraph;
+    class CTX;
 
 
     // GPU pipeline stage/access pair tracked per buffer in the render graph.
@@ -31,10 +37,16 @@ namespace mythril {
     struct SubresourceRange;
     struct SubresourceState;
     class TextureStateTracker;
+    class BufferStateTracker;
     struct CompiledImageBarrier;
     struct CompiledBufferBarrier;
     struct UploadData;
     struct CompiledPass;
+    struct CrossQueueSync;
+    struct BakedBarrierBatch;
+    struct SplitBarrier;
+    struct PassTimingHistory;
+    struct AdjacencyList;
 
     // builders are how the user interacts with a capability
     // BasePassBuilder is a blueprint for other PassBuilders only
@@ -44,6 +56,7 @@ namespace mythril {
     protected:
         RenderGraph& _rGraph;
         void setExecuteCallback(const std::function<void(CommandBuffer& cmd)>& callback);
+        void setParallelExecuteCallback(uint32_t chunkCount, const std::function<void(CommandBuffer& cmd, uint32_t chunk)>& callback);
     private:
         PassDesc _passSource;
         friend class GraphicsPassBuilder;
@@ -55,8 +68,8 @@ namespace mythril {
     inline void add(PassDesc& passSource, const TextureDesc& desc, const Layout layout) {
         passSource.textureDependencyOperations.emplace_back(desc, layout);
     }
-    inline void add(PassDesc& passSource, Buffer& buffer, const BufferAccess access) {
-        passSource.bufferDependencyOperations.push_back({buffer, access});
+    inline void add(PassDesc& passSource, Buffer& buffer, const BufferAccess access, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) {
+        passSource.bufferDependencyOperations.push_back({buffer, access, offset, size});
     }
     inline void add(PassDesc& passSource, const AttachmentDesc& desc) {
         passSource.attachmentOperations.push_back(desc);
@@ -85,6 +98,11 @@ namespace mythril {
             add(this->base._passSource, buffer, access);
             return *this;
         }
+    	// dependency for a byte range of a buffer
+        [[nodiscard]] GraphicsPassBuilder& dependency(Buffer& buffer, const BufferAccess access, VkDeviceSize offset, VkDeviceSize size) {
+            add(this->base._passSource, buffer, access, offset, size);
+            return *this;
+        }
     	// c style overload
         [[nodiscard]] GraphicsPassBuilder& dependency(Texture* tex, int count, const Layout layout = Layout::READ) {
             for (int i = 0; i < count; i++) {
@@ -114,10 +132,22 @@ namespace mythril {
             this->base._passSource.viewMask = viewMask;
 	        return *this;
         }
+        // the pass records the exact same commands every frame, so it is recorded once and replayed from then on
+        // re-recorded after a recompile, a resize, or once a pipeline, buffer or the bindless set it could reference changes
+        // the execute callback must not depend on anything else that changes between frames
+        [[nodiscard]] GraphicsPassBuilder& staticContent() {
+            this->base._passSource.isStatic = true;
+            return *this;
+        }
 
         void execute(const std::function<void(CommandBuffer& cmd)>& callback) {
             base.setExecuteCallback(callback);
         }
+        // splits recording into chunkCount secondary command buffers recorded on worker threads
+        // chunks are executed in index order, the callback must only record and be safe to call concurrently
+        void executeParallel(uint32_t chunkCount, const std::function<void(CommandBuffer& cmd, uint32_t chunk)>& callback) {
+            base.setParallelExecuteCallback(chunkCount, callback);
+        }
     private:
         BasePassBuilder base;
     };
@@ -139,6 +169,11 @@ namespace mythril {
             add(this->base._passSource, buffer, access);
             return *this;
         }
+        // dependency for a byte range of a buffer
+        [[nodiscard]] ComputePassBuilder& dependency(Buffer& buffer, const BufferAccess access, VkDeviceSize offset, VkDeviceSize size) {
+            add(this->base._passSource, buffer, access, offset, size);
+            return *this;
+        }
     	// c style overload
         [[nodiscard]] ComputePassBuilder& dependency(Texture* tex, int count, const Layout layout = Layout::GENERAL) {
             for (int i = 0; i < count; i++) {
@@ -161,6 +196,10 @@ namespace mythril {
         void execute(const std::function<void(CommandBuffer& cmd)>& callback) {
             base.setExecuteCallback(callback);
         }
+        // see GraphicsPassBuilder::executeParallel
+        void executeParallel(uint32_t chunkCount, const std::function<void(CommandBuffer& cmd, uint32_t chunk)>& callback) {
+            base.setParallelExecuteCallback(chunkCount, callback);
+        }
     private:
         BasePassBuilder base;
     };
@@ -176,6 +215,7 @@ namespace mythril {
         IntermediateBuilder& blit(TextureDesc src, TextureDesc dst);
         IntermediateBuilder& generateMipmaps(const Texture& texture);
         IntermediateBuilder& dependency(Buffer& buffer, BufferAccess access);
+        IntermediateBuilder& dependency(Buffer& buffer, BufferAccess access, VkDeviceSize offset, VkDeviceSize size);
         IntermediateBuilder& update(Buffer& buffer, std::function<UploadData()> dataCb, size_t dstOffset = 0);
         IntermediateBuilder& upload(Buffer& buffer, std::function<UploadData()> dataCb, size_t dstOffset = 0);
         void finish() const;
@@ -183,9 +223,6 @@ namespace mythril {
         BasePassBuilder base;
     };
 
-	// placeholder for Phase 3 timeline-semaphore cross-queue sync data
-	struct CrossQueueSync {};
-
 	struct ExecutionSchedule {
 		// maps a pass index to its depth level: passDepth[passIdx] = depth
 		std::unordered_map<uint32_t, uint32_t> pass_depths;
@@ -213,6 +250,34 @@ namespace mythril {
         [[nodiscard]] IntermediateBuilder addIntermediate(const char* pName) {
             return IntermediateBuilder{*this, pName};
         }
+        // a texture owned by the graph, its memory is only reserved between its first and last use in a frame
+        // transients whose lifetimes dont overlap share memory, so contents never survive into the next frame
+        // the returned reference stays valid for the lifetime of the graph
+        [[nodiscard]] Texture& createTransient(CTX& rCtx, const TextureSpec& spec);
+        // marks a resource whose final contents are wanted after the graph ran, culling keeps every pass that feeds it
+        // writing the swapchain already counts as an output, headless graphs need at least one of these
+        void markOutput(const Texture& texture);
+        void markOutput(const Buffer& buffer);
+        // opt in to deriving attachment load/store ops from the passes around them instead of the ones set by hand
+        // CLEAR is always kept, contents are only loaded when something wrote them and stored when something reads them
+        void setInferAttachmentOps(bool enable);
+        // attachment traffic per frame the inferred ops avoid compared to the ones set by hand, valid after compile
+        uint64_t getAttachmentBytesSaved() const { return _attachmentBytesSaved; }
+        // opt in to renaming transients where a write after read would lengthen the critical path
+        // the overwriting pass and everything after it get a second physical texture, so the write no longer waits on the reads
+        // callbacks keep using the Texture& from createTransient, it points at whichever version their pass was compiled against
+        void setTextureVersioning(bool enable);
+        // transient memory the second versions request before aliasing and the schedule layers they save, valid after compile
+        uint64_t getVersioningBytes() const { return _versioningBytes; }
+        uint32_t getVersioningLayersSaved() const { return _versioningLayersSaved; }
+        // lets compile move compute passes off the critical path onto async compute by itself
+        // uses the timings of previous frames when pass timings are enabled, every pass counts the same otherwise
+        void setAutoAsyncCompute(bool enable);
+        // writes gpu timestamps around every pass, results show up a few frames later without ever stalling
+        // works without tracy, the query pool is created at compile
+        void setPassTimingsEnabled(bool enable);
+        // one entry per compiled pass in execution order, empty until timings are enabled and the graph compiled
+        const std::vector<PassTiming>& getPassTimings() const { return _passTimings; }
         // compile is where ALL of the overhead should be, all data stored during setup is now translated into pieces that are easier to direct with
         // called sparingly, perhaps once
         void compile(CTX& rCtx);
@@ -224,20 +289,69 @@ namespace mythril {
         void resizeTrackedWindowSized(const Dimensions& swapchainDimensions) const;
     private:
         void PerformBarrierTransitions(CommandBuffer& cmd, const CompiledPass& compiledPass);
+        void recordBakedBarriers(CommandBuffer& cmd, BakedBarrierBatch& batch);
+        void recordSplitSignals(CommandBuffer& cmd, const BakedBarrierBatch& batch);
+        void destroySplitEvents();
+        void createTimestampPool(CTX& rCtx);
+        void destroyTimestampPool();
+        void collectPassTimings(CTX& rCtx);
+        void bakeBarrierBatches(CTX& rCtx);
+        void recordPass(CommandBuffer& cmd, uint32_t compiledIdx);
+        void recordOwnershipReleases(CommandBuffer& cmd, const CrossQueueSync& sync, QueueAffinity queue);
+        void recordOwnershipAcquires(CommandBuffer& cmd, QueueAffinity queue);
+        void executeMultiQueue(CommandBuffer& cmd);
+        void recordParallelPasses(CommandBuffer& cmd);
+        VkCommandBuffer getStaticSecondary(CommandBuffer& cmd, uint32_t compiledIdx);
+        void invalidateStaticPasses();
         static void processResourceAccess(const TextureDesc& texDesc, VkImageLayout desiredLayout, CompiledPass& outPass, std::string_view passName);
         static void processPassResources(const PassDesc& passDesc, CompiledPass& outPass);
 		static void processAttachments(const CTX& rCtx, const PassDesc& pass_desc, CompiledPass& outPass);
+        void inferAttachmentOps();
+        void planQueues(CTX& rCtx, const AdjacencyList& passPredecessors);
+        void restoreTextureVersions();
+        void selectTextureVersions(CTX& rCtx);
+        void swapTextureVersions(const CompiledPass& pass);
+        // cheap path for when only the images behind the graph changed, returns false if a full compile is needed
+        bool refreshResources(CTX& rCtx);
     	// this should not be const lol
         void performDryRun(CTX& rCtx);
         // every texture used in the framegraph needs proper tracking to ensure its layout is correct...
         // at every pass, even more necessary for textures that request individual mips/layers
         std::unordered_map<TextureHandle, TextureStateTracker> _resourceTrackers;
-        std::unordered_map<BufferHandle, StageAccess> _bufferTrackers;
+        std::unordered_map<BufferHandle, BufferStateTracker> _bufferTrackers;
         struct WindowSizedTexture {
             Texture* texture = nullptr;
             std::function<Dimensions(Dimensions)> scaleFn;
         };
         std::vector<WindowSizedTexture> _windowSizedTextures;
+        std::vector<TextureHandle> _outputTextures;
+        std::vector<BufferHandle> _outputBuffers;
+        bool _inferAttachmentOps = false;
+        bool _autoAsyncCompute = false;
+        bool _textureVersioning = false;
+        uint64_t _attachmentBytesSaved = 0;
+        uint64_t _versioningBytes = 0;
+        uint32_t _versioningLayersSaved = 0;
+        struct TransientTexture {
+            Texture texture;
+            // last accesses of everything sharing its memory, the first use in a frame has to wait on these
+            StageAccess aliasMask{};
+            // kept to create a second version from, the spec only points at the name stored next to it
+            TextureSpec spec;
+            std::string name;
+            // index of its second version, created the first time a compile renames it and reused afterwards
+            uint32_t versionIdx = UINT32_MAX;
+            // first pass desc of the last compile that uses the second version, UINT32_MAX when it wasnt renamed
+            uint32_t versionFirstPass = UINT32_MAX;
+            // set on second versions, index of the transient they stand in for
+            uint32_t versionOf = UINT32_MAX;
+        };
+        // deque so the Texture& handed out by createTransient never moves
+        std::deque<TransientTexture> _transientTextures;
+        std::vector<VmaAllocation> _transientAllocations;
+        CTX* _transientCtx = nullptr;
+        void allocateTransientMemory(CTX& rCtx);
+        void resetTransientStates(CTX& rCtx);
         // data used during compilation
         std::vector<PassDesc> _passDescriptions;
         // data fetched during execution
@@ -251,7 +365,45 @@ namespace mythril {
     	// per-layer, per-queue: which compiled-pass indices to record
     	std::vector<std::array<std::vector<uint32_t>, kQueueCount>> _layerByQueue;
     	// per-layer-boundary: which queues must wait on which producer queues' timelines
+    	// has one more entry than there are layers, the last one is the end of the frame
     	std::vector<CrossQueueSync> _layerSyncs;
+    	// false when every compiled pass landed on graphics, execute then records a single command buffer
+    	bool _hasAsyncWork = false;
+    	// one per compiled pass, only used when the frame is fully predictable (single queue, no conditions)
+    	std::vector<BakedBarrierBatch> _bakedBarriers;
+    	bool _canUseBakedBarriers = false;
+    	// the first frame after compile runs through the trackers, which is what the bake assumed as its starting point
+    	bool _bakedBarriersReady = false;
+    	// event backed halves of baked barriers, only ever used together with _bakedBarriers
+    	std::vector<SplitBarrier> _splitBarriers;
+    	// whoever owns the device objects the graph created itself (events, query pool)
+    	CTX* _deviceCtx = nullptr;
+    	// per pass gpu timestamps, a frame's queries are read back kTimestampLatency frames later
+    	static constexpr uint32_t kTimestampLatency = 4;
+    	bool _passTimingsEnabled = false;
+    	VkQueryPool _timestampPool = VK_NULL_HANDLE;
+    	// nanoseconds per tick and the valid bits of every queue, a mask of 0 means the queue cant be timed
+    	float _timestampPeriod = 0.f;
+    	std::array<uint64_t, kQueueCount> _timestampMasks{};
+    	uint64_t _timingFrame = 0;
+    	// [slot * passes + pass], only queries that were written can be read back
+    	std::vector<uint8_t> _timestampWritten;
+    	std::vector<PassTimingHistory> _timingHistories;
+    	std::vector<PassTiming> _passTimings;
+    	// acquire halves of ownership transfers released this boundary, kept around to reuse their capacity
+    	std::array<std::vector<VkImageMemoryBarrier2>, kQueueCount> _pendingImageAcquires;
+    	std::array<std::vector<VkBufferMemoryBarrier2>, kQueueCount> _pendingBufferAcquires;
+    	// per compiled pass, the secondaries recorded this frame for passes with a parallel callback
+    	// stays empty when no pass was recorded in parallel
+    	std::vector<std::vector<VkCommandBuffer>> _parallelSecondaries;
+    	bool _hasParallelPasses = false;
+    	// per compiled pass, the cached secondary of a static pass once it was recorded
+    	std::vector<VkCommandBuffer> _staticSecondaries;
+    	std::array<VkCommandPool, kQueueCount> _staticCommandPools{};
+    	// CTX::_commandEpoch the cached secondaries were recorded against
+    	uint64_t _staticCommandEpoch = 0;
+    	// executes since anything that allocates on first use was last thrown away, for MYTH_ENABLE_ALLOCATION_TRACKING
+    	uint32_t _numWarmFrames = 0;
 
         friend struct BasePassBuilder;
         friend class GraphicsPassBuilder;
@@ -8,6 +8,7 @@
 
 #include <functional>
 #include <optional>
+#include <string>
 #include <vector>
 #include <volk.h>
 
@@ -107,6 +108,21 @@ namespace mythril {
 	struct BufferDependencyDesc {
 		Buffer& buffer;
 		BufferAccess access = BufferAccess::ShaderRead;
+		// only these bytes are synchronized, passes on disjoint ranges of one buffer dont wait on each other
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = VK_WHOLE_SIZE;
+	};
+
+	// gpu time of a single pass as measured by RenderGraph's timestamp queries, min/avg/max cover the last samples
+	struct PassTiming {
+		std::string name;
+		QueueAffinity queue = QueueAffinity::Graphics;
+		float lastMs = 0.f;
+		float minMs = 0.f;
+		float avgMs = 0.f;
+		float maxMs = 0.f;
+		// how many frames min/avg/max were taken over, 0 until the first results came back
+		uint32_t numSamples = 0;
 	};
 
 	// user defined information from addPass and RenderPassBuilder
@@ -120,6 +136,12 @@ namespace mythril {
 		std::string name;
 		Type type;
 		std::function<void(CommandBuffer&)> executeCallback{};
+		// when set the pass is recorded in chunkCount secondaries across worker threads
+		// executeCallback still runs every chunk in order, for the dry run and single threaded paths
+		std::function<void(CommandBuffer&, uint32_t)> parallelCallback{};
+		uint32_t chunkCount = 0;
+		// recorded once into a reusable secondary and replayed every frame after
+		bool isStatic = false;
 		std::vector<AttachmentDesc> attachmentOperations;
 		std::vector<TextureDependencyDesc> textureDependencyOperations;
 		std::vector<BufferDependencyDesc> bufferDependencyOperations;
@@ -0,0 +1,80 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// only compiled with MYTH_ENABLE_ALLOCATION_TRACKING, every global new of the process goes through here
+namespace {
+	std::atomic<uint64_t> g_numHeapAllocations = 0;
+
+	void* CountedAlloc(std::size_t size, std::size_t alignment) {
+		g_numHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+		if (size == 0)
+			size = 1;
+		void* ptr = nullptr;
+		if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			ptr = std::malloc(size);
+		} else {
+#ifdef _MSC_VER
+			ptr = _aligned_malloc(size, alignment);
+#else
+			ptr = std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+		}
+		return ptr;
+	}
+	void CountedFree(void* ptr, std::size_t alignment) noexcept {
+#ifdef _MSC_VER
+		if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			_aligned_free(ptr);
+			return;
+		}
+#endif
+		std::free(ptr);
+	}
+} // namespace
+
+namespace mythril {
+	uint64_t GetNumHeapAllocations() {
+		return g_numHeapAllocations.load(std::memory_order_relaxed);
+	}
+} // namespace mythril
+
+void* operator new(std::size_t size) {
+	if (void* ptr = CountedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__))
+		return ptr;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+	if (void* ptr = CountedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__))
+		return ptr;
+	throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	if (void* ptr = CountedAlloc(size, static_cast<std::size_t>(alignment)))
+		return ptr;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	if (void* ptr = CountedAlloc(size, static_cast<std::size_t>(alignment)))
+		return ptr;
+	throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return CountedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return CountedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void* ptr) noexcept { CountedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, std::size_t) noexcept { CountedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr, std::size_t) noexcept { CountedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { CountedFree(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { CountedFree(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept { CountedFree(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept { CountedFree(ptr, static_cast<std::size_t>(alignment)); }
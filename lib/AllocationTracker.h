@@ -0,0 +1,14 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace mythril {
+#ifdef MYTH_ENABLED_ALLOCATION_TRACKING
+	// total calls to the global operator new across all threads since startup, only ever grows
+	uint64_t GetNumHeapAllocations();
+#endif
+} // namespace mythril
@@ -95,7 +95,10 @@ namespace mythril {
 			_transferQueueFamilyIndex != _computeQueueFamilyIndex && _vkTransferQueue)
 			this->_immAsyncTransfer = std::make_unique<ImmediateCommands>(this->_vkDevice, this->_transferQueueFamilyIndex, this->_vkTransferQueue);
 
-		this->_staging = std::make_unique<StagingDevice>(*this);
+		this->_staging = std::make_unique<StagingDevice>(*this, *this->_immGraphics);
+		if (this->_immAsyncTransfer)
+			this->_asyncStaging = std::make_unique<StagingDevice>(*this, *this->_immAsyncTransfer, this->_graphicsQueueFamilyIndex);
+		this->_readbackStaging = std::make_unique<StagingDevice>(*this, *this->_immGraphics);
 		// DEFAULT VULKAN OBJECTS
 		{
 			// pattern xor
@@ -148,6 +151,12 @@ namespace mythril {
 
 		destroy(this->_staging->_stagingBuffer);
 		this->_staging.reset(nullptr);
+		if (this->_asyncStaging) {
+			destroy(this->_asyncStaging->_stagingBuffer);
+			this->_asyncStaging.reset(nullptr);
+		}
+		destroy(this->_readbackStaging->_stagingBuffer);
+		this->_readbackStaging.reset(nullptr);
 		this->destroySwapchain();
 		this->_dummyTexture.release();
 		this->_dummyLinearSampler.release();
@@ -275,6 +284,25 @@ namespace mythril {
 		++_resourceEpoch;
 	}
 
+	WorkerPool& CTX::getWorkerPoolImpl() {
+		if (!_workerPool) {
+			// past a handful of threads recording is no longer the bottleneck
+			constexpr uint32_t kMaxRecordingThreads = 8;
+			const uint32_t numThreads = std::clamp(std::thread::hardware_concurrency(), 1u, kMaxRecordingThreads);
+			_workerPool = std::make_unique<WorkerPool>(numThreads - 1);
+		}
+		return *_workerPool;
+	}
+	void CTX::advanceFrameArenaImpl(SubmitHandle handle) {
+		_frameArenaSubmits[_frameArenaIdx] = handle;
+		_frameArenaIdx = (_frameArenaIdx + 1) % kNumFrameArenas;
+		// swapchain pacing normally retired this frame long ago, so the wait is only ever hit headless
+		const SubmitHandle retired = std::exchange(_frameArenaSubmits[_frameArenaIdx], SubmitHandle());
+		if (!retired.empty())
+			_immGraphics->wait(retired);
+		_frameArenas[_frameArenaIdx].reset();
+	}
+
 	void CTX::checkAndUpdateBindlessDescriptorSetImpl() {
 		MYTH_PROFILER_FUNCTION();
 		if (!_awaitingCreation) {
@@ -314,7 +342,8 @@ namespace mythril {
 			const AllocatedTexture& img = obj._obj;
 			// swapchain images must not be in bindless, after present, the drawable is returned to
 			// already presenting this drawable on moltenvk
-			const bool skipForBindless = img.isSwapchainImage();
+			// unbound transient textures have no view until their RenderGraph compiles
+			const bool skipForBindless = img.isSwapchainImage() || img._vkImageView == VK_NULL_HANDLE;
 			VkImageView view = skipForBindless ? dummyImageView : obj._obj._vkImageView;
 			VkImageView storageView = skipForBindless ? dummyImageView : (obj._obj._vkImageViewStorage ? obj._obj._vkImageViewStorage : obj._obj._vkImageView);
 			// multisampled images cannot be directly accessed from shaders
@@ -425,6 +454,7 @@ namespace mythril {
 		MYTH_PROFILER_FUNCTION();
 		_currentMaxSamplerCount = newMaxSamplerCount;
 		_currentMaxTextureCount = newMaxTextureCount;
+		++_commandEpoch;
 
 		const uint32_t MAX_TEXTURE_LIMIT = getPhysicalDeviceProperties12().maxDescriptorSetUpdateAfterBindSampledImages;
 		ASSERT_MSG(newMaxTextureCount <= MAX_TEXTURE_LIMIT, "Max sampled textures exceeded: {}, but maximum of {} is allowed!", newMaxTextureCount, MAX_TEXTURE_LIMIT);
@@ -687,7 +717,7 @@ namespace mythril {
 		// good to go, maybe later you could return it
 	}
 
-	void CTX::resolveGraphicsPipelineImpl(AllocatedGraphicsPipeline& pipeline, uint32_t viewMask) {
+	void CTX::resolveGraphicsPipelineImpl(AllocatedGraphicsPipeline& pipeline, uint32_t viewMask, const AttachmentFormats& passFormats) {
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_CREATE);
 		// updating descriptor layout //
 		//		if (graphics_pipeline->_vkLastDescriptorSetLayout != _vkBindlessDSL) {
@@ -713,16 +743,12 @@ namespace mythril {
 		builder.set_viewmask(viewMask);
 
 		// things we gather in the middle of the renderpass (attachment formats)
-		// looks at the current pass and reflects those formats in use
-		const CompiledPass& current_pass_info = _currentCommandBuffer._activePass;
-		std::vector<VkFormat> colorFormats;
-		colorFormats.reserve(current_pass_info.colorAttachments.size());
-		for (const AttachmentInfo& colorAttachment: current_pass_info.colorAttachments) {
-			colorFormats.push_back(colorAttachment.imageFormat);
-		}
-		builder.set_color_formats(colorFormats);
-		if (current_pass_info.depthAttachment.has_value()) {
-			builder.set_depth_format(current_pass_info.depthAttachment->imageFormat);
+		// the formats of the pass the pipeline is used in
+		// copied since the builder keeps pointing at the formats until the pipeline is built
+		AttachmentFormats formats = passFormats;
+		builder.set_color_formats(std::span(formats.colorFormats.data(), formats.numColorFormats));
+		if (formats.depthFormat != VK_FORMAT_UNDEFINED) {
+			builder.set_depth_format(formats.depthFormat);
 		}
 
 		// manually resolve the # of spec constants user gave
@@ -947,6 +973,13 @@ namespace mythril {
 			LOG_SYSTEM(LogType::Warning, "'resizeTexture' called on invalid handle!");
 			return;
 		}
+		if (image->_isTransient) {
+			// no memory to replace, the owning RenderGraph rebinds it on its next compile
+			image->_vkExtent = {newDimensions.width, newDimensions.height, newDimensions.depth};
+			resetTransientTextureImpl(handle);
+			++_resourceEpoch;
+			return;
+		}
 		// copies destroy for Texture logic
 		deferTask(std::packaged_task<void()>([device = _vkDevice, imageView = image->_vkImageView]() { vkDestroyImageView(device, imageView, nullptr); }));
 		if (image->_vkImageViewStorage) {
@@ -1006,6 +1039,9 @@ namespace mythril {
 
 	Texture CTX::createTexture(TextureSpec spec) {
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_CREATE);
+		return {this, createTextureFromSpecImpl(spec, false)};
+	}
+	TextureHandle CTX::createTextureFromSpecImpl(TextureSpec spec, bool isTransient) {
 		ASSERT_MSG(spec.usage, "The usage field for TextureSpec is required, however '{}' was not given one!", spec.debugName);
 		ASSERT_MSG(!(spec.generateMipmaps && spec.initialData == nullptr), "'generateMipMaps' can only be true when 'initialData' is non-null!");
 		// resolve usage flags
@@ -1068,13 +1104,21 @@ namespace mythril {
 				assert(false);
 		}
 		const VkComponentMapping component_mappings = spec.components.toVkComponentMapping();
-		AllocatedTexture obj = createTextureImpl(usage_flags, mem_flags, extent3D, spec.format, _imagetype, _imageviewtype, _numLevels, _numLayers, sample_bits, component_mappings, _imageCreateFlags);
+		AllocatedTexture obj = createTextureImpl(usage_flags, mem_flags, extent3D, spec.format, _imagetype, _imageviewtype, _numLevels, _numLayers, sample_bits, component_mappings, _imageCreateFlags, isTransient);
 		// members that are only needed for recreation
 		obj._vkMemoryPropertyFlags = mem_flags;
 		obj._vkImageViewType = _imageviewtype;
 		snprintf(obj._debugName, sizeof(obj._debugName), "%s", spec.debugName);
-		vmaSetAllocationName(_vmaAllocator, obj._vmaAllocation, obj._debugName);
 		vkutil::SetObjectDebugName(_vkDevice, VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(obj._vkImage), obj.getDebugName().data());
+		if (isTransient) {
+			// no memory or views yet, those come with bindTransientTextureImpl
+			ASSERT_MSG(!spec.initialData, "Transient texture '{}' cannot have initial data, its contents do not survive a frame!", spec.debugName);
+			ASSERT_MSG(spec.storage == StorageType::Device, "Transient texture '{}' must use StorageType::Device!", spec.debugName);
+			TextureHandle handle = _texturePool.create(std::move(obj));
+			_awaitingCreation = true;
+			return handle;
+		}
+		vmaSetAllocationName(_vmaAllocator, obj._vmaAllocation, obj._debugName);
 		char d[32];
 		snprintf(d, sizeof(d), "%s - Default View", spec.debugName);
 		vkutil::SetObjectDebugName(_vkDevice, VK_OBJECT_TYPE_IMAGE_VIEW, reinterpret_cast<uint64_t>(obj._vkImageView), d);
@@ -1091,7 +1135,57 @@ namespace mythril {
 				this->generateMipmaps(handle);
 			}
 		}
-		return {this, handle};
+		return handle;
+	}
+	void CTX::bindTransientTextureImpl(TextureHandle handle, VmaAllocation allocation) {
+		AllocatedTexture& image = access(handle);
+		ASSERT_MSG(image._isTransient, "Texture '{}' is not transient!", image.getDebugName());
+		ASSERT_MSG(image._vkImageView == VK_NULL_HANDLE, "Transient texture '{}' is already bound, it must be reset first!", image.getDebugName());
+		// the allocation is shared, the image never owns it
+		VK_CHECK(vmaBindImageMemory(_vmaAllocator, allocation, image._vkImage));
+		createTextureViewsImpl(image);
+		char d[32];
+		snprintf(d, sizeof(d), "%s - Default View", image._debugName);
+		vkutil::SetObjectDebugName(_vkDevice, VK_OBJECT_TYPE_IMAGE_VIEW, reinterpret_cast<uint64_t>(image._vkImageView), d);
+		image._vkCurrentImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		_awaitingCreation = true;
+	}
+	// a VkImage can only ever be bound once, so new memory (recompile or resize) means a new image
+	void CTX::resetTransientTextureImpl(TextureHandle handle) {
+		AllocatedTexture& image = access(handle);
+		ASSERT_MSG(image._isTransient, "Texture '{}' is not transient!", image.getDebugName());
+		if (image._vkImageView) {
+			deferTask(std::packaged_task<void()>([device = _vkDevice, imageView = image._vkImageView]() { vkDestroyImageView(device, imageView, nullptr); }));
+		}
+		if (image._vkImageViewStorage) {
+			deferTask(std::packaged_task<void()>([device = _vkDevice, imageView = image._vkImageViewStorage]() { vkDestroyImageView(device, imageView, nullptr); }));
+		}
+		deferTask(std::packaged_task<void()>([device = _vkDevice, vkImage = image._vkImage]() { vkDestroyImage(device, vkImage, nullptr); }));
+
+		VkImageCreateFlags createFlags = 0;
+		if (image._vkImageViewType == VK_IMAGE_VIEW_TYPE_CUBE || image._vkImageViewType == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY) {
+			createFlags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+		}
+		const AllocatedTexture newImage = this->createTextureImpl(
+		        image._vkUsageFlags,
+		        image._vkMemoryPropertyFlags,
+		        image._vkExtent,
+		        image._vkFormat,
+		        image._vkImageType,
+		        image._vkImageViewType,
+		        image._numLevels,
+		        image._numLayers,
+		        image.getVkSampleCountBits(),
+		        image._vkComponentMappings,
+		        createFlags,
+		        true
+		);
+		vkutil::SetObjectDebugName(_vkDevice, VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(newImage._vkImage), image.getDebugName().data());
+		image._vkImage = newImage._vkImage;
+		image._vkImageView = VK_NULL_HANDLE;
+		image._vkImageViewStorage = VK_NULL_HANDLE;
+		image._vkCurrentImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		_awaitingCreation = true;
 	}
 	// todo: review this, as it seems alot of the data can simply be read straight from the copy instead of being resolved again
 	// https://github.com/corporateshark/lightweightvk/blob/master/lvk/vulkan/VulkanClasses.cpp#L4351
@@ -1152,7 +1246,8 @@ namespace mythril {
 	        uint32_t numLayers,
 	        VkSampleCountFlagBits sampleCountFlagBits,
 	        VkComponentMapping componentMapping,
-	        VkImageCreateFlags createFlags
+	        VkImageCreateFlags createFlags,
+	        bool isTransient
 	) {
 		ASSERT_MSG(numLevels > 0, "The texture must contain at least one mip-level!");
 		ASSERT_MSG(numLayers > 0, "The texture must contain at least one layer!");
@@ -1181,11 +1276,16 @@ namespace mythril {
 		    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
 		};
 
-		VmaAllocationCreateInfo allocation_ci = {};
-		allocation_ci.usage = (memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? VMA_MEMORY_USAGE_CPU_TO_GPU : VMA_MEMORY_USAGE_AUTO;
-
 		AllocatedTexture obj = {};
-		VK_CHECK(vmaCreateImage(_vmaAllocator, &image_ci, &allocation_ci, &obj._vkImage, &obj._vmaAllocation, nullptr));
+		if (isTransient) {
+			VK_CHECK(vkCreateImage(_vkDevice, &image_ci, nullptr, &obj._vkImage));
+		} else {
+			VmaAllocationCreateInfo allocation_ci = {};
+			allocation_ci.usage = (memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? VMA_MEMORY_USAGE_CPU_TO_GPU : VMA_MEMORY_USAGE_AUTO;
+			VK_CHECK(vmaCreateImage(_vmaAllocator, &image_ci, &allocation_ci, &obj._vkImage, &obj._vmaAllocation, nullptr));
+		}
+		obj._isTransient = isTransient;
+		obj._vkComponentMappings = componentMapping;
 		obj._vkExtent = extent3D;
 		obj._vkUsageFlags = usageFlags;
 		obj._sampleCount = sampleCountFlagBits;
@@ -1213,29 +1313,35 @@ namespace mythril {
 		);
 
 
+		// views need bound memory, transient ones get theirs when the RenderGraph binds them
+		if (isTransient) {
+			return obj;
+		}
 		// if memory is manually managed on host
 		if (memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
 			VK_CHECK(vmaMapMemory(_vmaAllocator, obj._vmaAllocation, &obj._mappedPtr));
 		}
-		// create image views
+		createTextureViewsImpl(obj);
+		return obj;
+	}
+	void CTX::createTextureViewsImpl(AllocatedTexture& obj) {
 		const VkImageAspectFlags aspectMask = vkutil::AspectMaskFromFormat(obj._vkFormat);
 		VkImageViewCreateInfo image_view_ci = {
 		    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
 		    .flags = 0,
 		    .image = obj._vkImage,
 		    .viewType = obj._vkImageViewType,
-		    .format = format,
-		    .components = componentMapping,
-		    .subresourceRange = {.aspectMask = aspectMask, .baseMipLevel = 0, .levelCount = numLevels, .baseArrayLayer = 0, .layerCount = numLayers},
+		    .format = obj._vkFormat,
+		    .components = obj._vkComponentMappings,
+		    .subresourceRange = {.aspectMask = aspectMask, .baseMipLevel = 0, .levelCount = obj._numLevels, .baseArrayLayer = 0, .layerCount = obj._numLayers},
 		};
 		VK_CHECK(vkCreateImageView(_vkDevice, &image_view_ci, nullptr, &obj._vkImageView));
 		if (obj._vkUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT) {
-			if (!vkutil::IsComponentMappingAnIdentity(componentMapping)) {
+			if (!vkutil::IsComponentMappingAnIdentity(obj._vkComponentMappings)) {
 				image_view_ci.components = {};
 				VK_CHECK(vkCreateImageView(_vkDevice, &image_view_ci, nullptr, &obj._vkImageViewStorage));
 			}
 		}
-		return obj;
 	}
 
 	GraphicsPipeline CTX::createGraphicsPipeline(const GraphicsPipelineSpec& spec) {
@@ -1315,15 +1421,21 @@ namespace mythril {
 			return;
 		}
 		ASSERT(image->_vkCurrentImageLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+		// the base level may still sit in an open upload batch
+		if (_staging->isBatching())
+			_staging->submitBatch();
 		const ImmediateCommands::CommandBufferWrapper& wrapper = _immGraphics->acquire();
 		image->generateMipmap(wrapper._cmdBuf);
 		_immGraphics->submit(wrapper);
 	}
 	void CTX::upload(BufferHandle handle, const void* data, size_t size, size_t offset) {
 		MYTH_PROFILER_FUNCTION();
+		uploadBufferImpl(*_staging, handle, data, size, offset);
+	}
+	bool CTX::uploadBufferImpl(StagingDevice& staging, BufferHandle handle, const void* data, size_t size, size_t offset) {
 		if (!data) {
 			LOG_SYSTEM(LogType::Warning, "Attempting to upload data which is null!");
-			return;
+			return false;
 		}
 		ASSERT_MSG(size > 0, "Size must be greater than 0!");
 		ASSERT_MSG(handle.valid(), "CTX::upload called with an invalid BufferHandle.");
@@ -1332,7 +1444,8 @@ namespace mythril {
 		ASSERT_MSG(buffer, "CTX::upload: handle does not resolve to a live buffer.");
 		ASSERT_MSG(offset + size <= buffer->_bufferSize, "CTX::upload: offset + size ({}) exceeds buffer '{}' size ({}).", offset + size, buffer->_debugName, buffer->_bufferSize);
 		ASSERT_MSG(buffer->isMapped() || (buffer->_vkUsageFlags & VK_BUFFER_USAGE_TRANSFER_DST_BIT), "CTX::upload: device buffer '{}' was not created with TRANSFER_DST usage.", buffer->_debugName);
-		_staging->bufferSubData(*buffer, offset, size, data);
+		staging.bufferSubData(*buffer, offset, size, data);
+		return !buffer->isMapped();
 	}
 	void CTX::download(BufferHandle handle, void* data, size_t size, size_t offset) {
 		MYTH_PROFILER_FUNCTION();
@@ -1354,10 +1467,13 @@ namespace mythril {
 	}
 	void CTX::upload(TextureHandle handle, const void* data, const TexRange& range) {
 		MYTH_PROFILER_FUNCTION();
+		uploadTextureImpl(*_staging, handle, data, range);
+	}
+	bool CTX::uploadTextureImpl(StagingDevice& staging, TextureHandle handle, const void* data, const TexRange& range) {
 		ASSERT_MSG(handle.valid(), "CTX::upload called with an invalid TextureHandle.");
 		if (!data) {
 			LOG_SYSTEM(LogType::Warning, "Attempting to upload data which is null!");
-			return;
+			return false;
 		}
 		AllocatedTexture* image = _texturePool.get(handle);
 		ASSERT_MSG(image, "Attempting to use texture via invalid handle!");
@@ -1365,7 +1481,7 @@ namespace mythril {
 		ASSERT_MSG(ValidateRange(image->_vkExtent, image->_numLevels, range), "CTX::upload: TexRange is out of bounds for texture '{}'.", image->_debugName);
 		// why is this here
 		if (image->_vkImageType == VK_IMAGE_TYPE_3D) {
-			_staging->imageData3D(
+			staging.imageData3D(
 			        *image, VkOffset3D{range.offset.x, range.offset.y, range.offset.z}, VkExtent3D{range.dimensions.width, range.dimensions.height, range.dimensions.depth}, image->_vkFormat, data
 			);
 		} else {
@@ -1373,8 +1489,113 @@ namespace mythril {
 			    .offset = {.x = range.offset.x, .y = range.offset.y},
 			    .extent = {.width = range.dimensions.width, .height = range.dimensions.height},
 			};
-			_staging->imageData2D(*image, image_region, range.mipLevel, range.numMipLevels, range.layer, range.numLayers, image->_vkFormat, data);
+			staging.imageData2D(*image, image_region, range.mipLevel, range.numMipLevels, range.layer, range.numLayers, image->_vkFormat, data);
+		}
+		return true;
+	}
+	void CTX::beginUploadBatch() {
+		_staging->beginBatch();
+	}
+	SubmitHandle CTX::flushUploadBatch() {
+		MYTH_PROFILER_FUNCTION();
+		return _staging->endBatch();
+	}
+	void CTX::wait(SubmitHandle handle) {
+		// an empty handle would idle the whole device, for an empty batch there is nothing to wait on
+		if (handle.empty())
+			return;
+		_immGraphics->wait(handle);
+	}
+	UploadTicket CTX::uploadAsync(BufferHandle handle, const void* data, size_t size, size_t offset) {
+		MYTH_PROFILER_FUNCTION();
+		if (!_asyncStaging) {
+			upload(handle, data, size, offset);
+			return {};
 		}
+		if (!uploadBufferImpl(*_asyncStaging, handle, data, size, offset))
+			return {};
+		return {.value_ = _immAsyncTransfer->getLastTimelineValue()};
+	}
+	UploadTicket CTX::uploadAsync(TextureHandle handle, const void* data, const TexRange& range) {
+		MYTH_PROFILER_FUNCTION();
+		if (!_asyncStaging) {
+			upload(handle, data, range);
+			return {};
+		}
+		if (!uploadTextureImpl(*_asyncStaging, handle, data, range))
+			return {};
+		return {.value_ = _immAsyncTransfer->getLastTimelineValue()};
+	}
+	bool CTX::isUploadReady(UploadTicket ticket) const {
+		if (ticket.empty() || !_asyncStaging)
+			return true;
+		uint64_t completedValue = 0;
+		VK_CHECK(vkGetSemaphoreCounterValue(_vkDevice, _immAsyncTransfer->getTimelineSemaphore(), &completedValue));
+		return completedValue >= ticket.value_;
+	}
+	void CTX::awaitUpload(UploadTicket ticket) {
+		if (ticket.empty() || !_asyncStaging)
+			return;
+		_awaitedUploadValue = std::max(_awaitedUploadValue, ticket.value_);
+		// with a command buffer open the acquire goes in right away, otherwise the next acquireCommand picks it up
+		if (_currentCommandBuffer._ctx) {
+			ASSERT_MSG(!_currentCommandBuffer._isRendering, "Cannot await an upload while rendering!");
+			acquireAsyncUploadsImpl(_currentCommandBuffer._wrapper->_cmdBuf);
+		}
+	}
+	ReadbackTicket CTX::requestReadback(BufferHandle handle, size_t size, size_t offset, StagingDevice::ReadbackCallback callback) {
+		MYTH_PROFILER_FUNCTION();
+		ASSERT_MSG(size > 0, "Size must be greater than 0!");
+		AllocatedBuffer* buffer = _bufferPool.get(handle);
+		ASSERT_MSG(buffer, "CTX::requestReadback: handle does not resolve to a live buffer.");
+		ASSERT_MSG(offset + size <= buffer->_bufferSize, "CTX::requestReadback: offset + size ({}) exceeds buffer '{}' size ({}).", offset + size, buffer->_debugName, buffer->_bufferSize);
+		ASSERT_MSG(buffer->_vkUsageFlags & VK_BUFFER_USAGE_TRANSFER_SRC_BIT, "CTX::requestReadback: buffer '{}' was not created with TRANSFER_SRC usage.", buffer->_debugName);
+		ASSERT_MSG(!_currentCommandBuffer._isRendering, "Cannot request a readback while rendering!");
+		const VkCommandBuffer cmd = _currentCommandBuffer._ctx ? _currentCommandBuffer._wrapper->_cmdBuf : VK_NULL_HANDLE;
+		return {.id_ = _readbackStaging->requestBufferReadback(cmd, *buffer, offset, size, std::move(callback))};
+	}
+	ReadbackTicket CTX::requestReadback(TextureHandle handle, const TexRange& range, StagingDevice::ReadbackCallback callback) {
+		MYTH_PROFILER_FUNCTION();
+		AllocatedTexture* image = _texturePool.get(handle);
+		ASSERT_MSG(image, "CTX::requestReadback: handle does not resolve to a live texture.");
+		ASSERT_MSG(ValidateRange(image->_vkExtent, image->_numLevels, range), "CTX::requestReadback: TexRange is out of bounds for texture '{}'.", image->_debugName);
+		ASSERT_MSG(!_currentCommandBuffer._isRendering, "Cannot request a readback while rendering!");
+		const VkCommandBuffer cmd = _currentCommandBuffer._ctx ? _currentCommandBuffer._wrapper->_cmdBuf : VK_NULL_HANDLE;
+		const uint32_t id = _readbackStaging->requestImageReadback(
+		        cmd,
+		        *image,
+		        VkOffset3D{range.offset.x, range.offset.y, range.offset.z},
+		        VkExtent3D{range.dimensions.width, range.dimensions.height, range.dimensions.depth},
+		        VkImageSubresourceRange{
+		            .aspectMask = vkutil::AspectMaskFromFormat(image->_vkFormat),
+		            .baseMipLevel = range.mipLevel,
+		            .levelCount = range.numMipLevels,
+		            .baseArrayLayer = range.layer,
+		            .layerCount = range.numLayers,
+		        },
+		        image->_vkFormat,
+		        std::move(callback)
+		);
+		return {.id_ = id};
+	}
+	bool CTX::isReadbackReady(ReadbackTicket ticket) const {
+		return !ticket.empty() && _readbackStaging->isReadbackReady(ticket.id_);
+	}
+	bool CTX::fetchReadback(ReadbackTicket ticket, void* outData, size_t size) {
+		if (ticket.empty() || !outData)
+			return false;
+		return _readbackStaging->fetchReadback(ticket.id_, outData, size);
+	}
+	void CTX::acquireAsyncUploadsImpl(VkCommandBuffer cmd) {
+		if (!_asyncStaging)
+			return;
+		// uploads that already finished are taken over without being awaited, waiting on them costs nothing anymore
+		uint64_t completedValue = 0;
+		VK_CHECK(vkGetSemaphoreCounterValue(_vkDevice, _immAsyncTransfer->getTimelineSemaphore(), &completedValue));
+		const uint64_t acquiredValue = _asyncStaging->recordAcquires(cmd, std::max(completedValue, _awaitedUploadValue));
+		_awaitedUploadValue = 0;
+		if (acquiredValue)
+			_immGraphics->waitTimelineSemaphore(_immAsyncTransfer->getTimelineSemaphore(), acquiredValue);
 	}
 	void CTX::download(TextureHandle handle, void* data, const TexRange& range) {
 		MYTH_PROFILER_FUNCTION();
@@ -1410,7 +1631,7 @@ namespace mythril {
 
 	CommandBuffer CTX::createActiveCommand(CommandBuffer::Type type) {
 		_staging->resetPending();
-		if (type == CommandBuffer::Type::Graphics) {
+		if (type == CommandBuffer::Type::Graphics && !isHeadless()) {
 			const VkSemaphore acquire_semaphore = _swapchain->acquire();
 			_immGraphics->waitSemaphore(acquire_semaphore);
 			wrappedBackBuffer.updateHandle(this, _swapchain->getCurrentSwapchainTextureHandle());
@@ -1428,12 +1649,15 @@ namespace mythril {
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_ACQUIRE);
 		ASSERT_MSG(!_currentCommandBuffer._ctx, "Cannot open more than 1 CommandBuffer simultaneously!");
 		_staging->resetPending();
-		if (type == CommandBuffer::Type::Graphics) {
+		_readbackStaging->resetPending();
+		// headless graphics work is submitted like anything else, there is nothing to acquire or present
+		if (type == CommandBuffer::Type::Graphics && !isHeadless()) {
 			VkSemaphore acquire_semaphore = _swapchain->acquire();
 			_immGraphics->waitSemaphore(acquire_semaphore);
 			wrappedBackBuffer.updateHandle(this, _swapchain->getCurrentSwapchainTextureHandle());
 		}
 		_currentCommandBuffer = CommandBuffer(this, type);
+		acquireAsyncUploadsImpl(_currentCommandBuffer._wrapper->_cmdBuf);
 		return _currentCommandBuffer;
 	}
 	SubmitHandle CTX::submitCommand(CommandBuffer& cmd) {
@@ -1444,21 +1668,27 @@ namespace mythril {
 		if (_tracyPlugin.isEnabled())
 			TracyVkCollect(_tracyPlugin.getTracyVkCtx(), cmd._wrapper->_cmdBuf);
 #endif
-		const bool isPresenting = cmd._cmdType == CommandBuffer::Type::Graphics;
+		const bool isPresenting = cmd._cmdType == CommandBuffer::Type::Graphics && !isHeadless();
 		if (isPresenting) {
 			const uint32_t frameIndex = _swapchain->getCurrentFrameIndex();
 			const uint64_t signalValue = _currentFrameNumber + _swapchain->getNumOfSwapchainImages();
 			_swapchain->_timelineWaitValues[frameIndex] = signalValue;
 			_immGraphics->signalSemaphore(_timelineSemaphore, signalValue);
 		}
+		// uploads batched while recording have to land before the frame reads them
+		if (_staging->isBatching())
+			_staging->submitBatch();
 		cmd._lastSubmitHandle = _immGraphics->submit(*cmd._wrapper);
 		_staging->onGraphSubmit(cmd._lastSubmitHandle);
+		_readbackStaging->onGraphSubmit(cmd._lastSubmitHandle);
+		advanceFrameArenaImpl(cmd._lastSubmitHandle);
 		if (isPresenting) {
 			ASSERT(_texturePool.get(_swapchain->getCurrentSwapchainTextureHandle())->getImageLayout() == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 			_swapchain->present(_immGraphics->acquireLastSubmitSemaphore());
 		}
 		_currentFrameNumber++;
 		processDeferredTasks();
+		_readbackStaging->processReadbacks();
 		const SubmitHandle handle = cmd._lastSubmitHandle;
 		_currentCommandBuffer = {};
 		return handle;
@@ -1544,6 +1774,7 @@ namespace mythril {
 		}
 		deferTask(std::packaged_task<void()>([vma = _vmaAllocator, buffer = buf->_vkBuffer, allocation = buf->_vmaAllocation]() { vmaDestroyBuffer(vma, buffer, allocation); }));
 		_bufferPool.destroy(handle);
+		++_commandEpoch;
 	}
 	void CTX::destroy(TextureHandle handle) {
 		AllocatedTexture* image = _texturePool.get(handle);
@@ -1587,6 +1818,7 @@ namespace mythril {
 		deferTask(std::packaged_task<void()>([device = _vkDevice, pipeline = core._vkPipeline]() { vkDestroyPipeline(device, pipeline, nullptr); }));
 		deferTask(std::packaged_task<void()>([device = _vkDevice, layout = core._vkPipelineLayout]() { vkDestroyPipelineLayout(device, layout, nullptr); }));
 		_graphicsPipelinePool.destroy(handle);
+		++_commandEpoch;
 	}
 	void CTX::destroy(ComputePipelineHandle handle) {
 		AllocatedComputePipeline* compute_pipeline = _computePipelinePool.get(handle);
@@ -1596,6 +1828,7 @@ namespace mythril {
 		deferTask(std::packaged_task<void()>([device = _vkDevice, pipeline = core._vkPipeline]() { vkDestroyPipeline(device, pipeline, nullptr); }));
 		deferTask(std::packaged_task<void()>([device = _vkDevice, layout = core._vkPipelineLayout]() { vkDestroyPipelineLayout(device, layout, nullptr); }));
 		_computePipelinePool.destroy(handle);
+		++_commandEpoch;
 	}
 } // namespace mythril
 #ifdef MYTH_ENABLED_IMGUI
@@ -43,7 +43,7 @@ PassSourceTypeToString(goalType));
 #define CHECK_PIPELINE_REBIND(common, lastBound, debugName) \
 	do { \
 		if ((common)->_vkPipeline == (lastBound)) { \
-			static std::unordered_map<VkPipeline, int> g_rebindWarningCount; \
+			thread_local std::unordered_map<VkPipeline, int> g_rebindWarningCount; \
 			int& count = g_rebindWarningCount[(common)->_vkPipeline]; \
 			static constexpr unsigned int kMaxWarns = 5; \
 			if (count < kMaxWarns) { \
@@ -90,7 +90,7 @@ namespace mythril {
 	}
 
 	static void MaybeWarnPushConstantSizeMismatch(const PipelineCoreData& common, uint32_t cpuSize, std::string_view pipelineName) {
-		static std::unordered_map<VkPipeline, int> g_pushConstantWarningCount;
+		thread_local std::unordered_map<VkPipeline, int> g_pushConstantWarningCount;
 		int& count = g_pushConstantWarningCount[common._vkPipeline];
 		static constexpr unsigned int kMaxWarns = 5;
 
@@ -128,11 +128,18 @@ namespace mythril {
 	constexpr uint16_t kMaxColorAttachments = 16;
 	// enforce that a valid CommandBuffer can only be created via this constructor
 	CommandBuffer::CommandBuffer(CTX* ctx, CommandBuffer::Type type) :
+	    CommandBuffer(ctx, type, ctx->_immGraphics.get()) {}
+	CommandBuffer::CommandBuffer(CTX* ctx, CommandBuffer::Type type, ImmediateCommands* queue) :
 	    _ctx(ctx),
-	    _wrapper(&ctx->_immGraphics->acquire()),
-	    _activePass(),
+	    _wrapper(&queue->acquire()),
 	    _cmdType(type),
 	    _isDryRun(false) {}
+	CommandBuffer::CommandBuffer(CTX* ctx, CommandBuffer::Type type, const ImmediateCommands::CommandBufferWrapper& secondary) :
+	    _ctx(ctx),
+	    _wrapper(&secondary),
+	    _cmdType(type),
+	    _isDryRun(false),
+	    _isSecondary(true) {}
 
 	CommandBuffer::~CommandBuffer() { ASSERT_MSG(!_isRendering, "Please call to end rendering before destroying a Command Buffer!"); }
 	VkCommandBufferSubmitInfo CommandBuffer::requestSubmitInfo() const {
@@ -152,6 +159,7 @@ namespace mythril {
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_COMMAND);
 		MYTH_PROFILER_GPU_ZONE("cmdBeginRendering()", _wrapper->_cmdBuf, MYTH_PROFILER_COLOR_COMMAND);
 		CHECK_PASS_OPERATION_MISMATCH(PassDesc::Type::Graphics);
+		ASSERT_MSG(_activePass, "cmdBeginRendering() must be called inside a RenderGraph pass!");
 #ifdef DEBUG
 		static bool hasTriggered = false;
 		if ((_currentPipelineInfo && (layerCount != 1 || viewMask != 0) && !hasTriggered)) {
@@ -274,16 +282,16 @@ namespace mythril {
 		return true;
 	}
 	void CommandBuffer::CheckTextureRenderingUsage(const AllocatedTexture& source, const AllocatedTexture& destination, const char* operation) {
-		if (_isRendering) {
+		if (_isRendering && this->_activePass) {
 			VkImageView source_vkImageView = source._vkImageView;
 			VkImageView dest_vkImageView = destination._vkImageView;
-			for (const auto& color_attachment: this->_activePass.colorAttachments) {
+			for (const auto& color_attachment: this->_activePass->colorAttachments) {
 				ASSERT_MSG(
 				        color_attachment.imageView != source_vkImageView && color_attachment.imageView != dest_vkImageView, "You cannot {} an image currently being used by a RenderPass!", operation
 				);
 			}
-			if (this->_activePass.depthAttachment.has_value()) {
-				const auto& depth_attachment = this->_activePass.depthAttachment.value();
+			if (this->_activePass->depthAttachment.has_value()) {
+				const auto& depth_attachment = this->_activePass->depthAttachment.value();
 				ASSERT_MSG(
 				        depth_attachment.imageView != source_vkImageView && depth_attachment.imageView != dest_vkImageView, "You cannot {} an image currently being used by a RenderPass!", operation
 				);
@@ -449,11 +457,18 @@ namespace mythril {
 			}
 			// we perform construction inside our dry run for all pipelines, which is when we compile the RenderGraph
 			// we do this so we dont stutter mid gameplay loop
-			_ctx->resolveGraphicsPipelineImpl(*pipeline, _viewMask);
+			if (_pendingPipelines) {
+				_pendingPipelines->push_back({.graphics = handle, .viewMask = _viewMask, .pass = _activePass});
+				return;
+			}
+			_ctx->resolveGraphicsPipelineImpl(*pipeline, _viewMask, _activePass ? _activePass->formats : AttachmentFormats{});
+			++_ctx->_commandEpoch;
 			return;
 		}
-		if (pipeline->_shared.needsRecompile) {
-			_ctx->resolveGraphicsPipelineImpl(*pipeline, _viewMask);
+		// rebuilding bumps the CTX's command epoch, so secondaries keep the old pipeline until a serial pass rebuilds it
+		if (pipeline->_shared.needsRecompile && !_isSecondary) {
+			_ctx->resolveGraphicsPipelineImpl(*pipeline, _viewMask, _activePass ? _activePass->formats : AttachmentFormats{});
+			++_ctx->_commandEpoch;
 		}
 		this->_currentPipelineHandle = handle;
 		this->_currentPipelineInfo = &pipeline->_shared;
@@ -479,7 +494,12 @@ namespace mythril {
 				// LOG_SYSTEM(LogType::Error, "Dry run attempting to resolve Pipeline '{}' that has already been built!", pipeline->getDebugName());
 				return;
 			}
+			if (_pendingPipelines) {
+				_pendingPipelines->push_back({.compute = handle, .pass = _activePass});
+				return;
+			}
 			_ctx->resolveComputePipelineImpl(*pipeline);
+			++_ctx->_commandEpoch;
 			return;
 		}
 		this->_currentPipelineHandle = handle;
@@ -586,12 +606,14 @@ namespace mythril {
 		CHECK_SHOULD_BE_RENDERING();
 		CHECK_PASS_OPERATION_MISMATCH(PassDesc::Type::Graphics);
 #ifdef DEBUG
-		for (const auto& color_attachment: this->_activePass.colorAttachments) {
-			ASSERT_MSG(color_attachment.resolveImageView == VK_NULL_HANDLE, "Rendering of ImGui cannot be done inside a multisampled texture!");
-			ASSERT_MSG(
-			        color_attachment.imageFormat == this->_ctx->_imguiPlugin.getFormat(),
-			        "ImGui is drawing to a format that it was not given! Please pass the VkFormat of the texture which ImGui is drawing to when calling 'withImGuiPlugin()'!"
-			);
+		if (this->_activePass) {
+			for (const auto& color_attachment: this->_activePass->colorAttachments) {
+				ASSERT_MSG(color_attachment.resolveImageView == VK_NULL_HANDLE, "Rendering of ImGui cannot be done inside a multisampled texture!");
+				ASSERT_MSG(
+				        color_attachment.imageFormat == this->_ctx->_imguiPlugin.getFormat(),
+				        "ImGui is drawing to a format that it was not given! Please pass the VkFormat of the texture which ImGui is drawing to when calling 'withImGuiPlugin()'!"
+				);
+			}
 		}
 #endif
 		ImGui::Render();
@@ -600,28 +622,29 @@ namespace mythril {
 #endif
 
 	// ALL INTERNALLY CALLED COMMAND BUFFER FUNCTIONS
-	void CommandBuffer::cmdBeginRenderingImpl(uint32_t layerCount, uint32_t viewMask) {
+	void CommandBuffer::cmdBeginRenderingImpl(uint32_t layerCount, uint32_t viewMask, VkRenderingFlags flags) {
 		ASSERT_MSG(!_isRendering, "Command Buffer is already rendering!");
-		const bool hasDepth = _activePass.depthAttachment.has_value();
-		const VkRect2D renderArea = _activePass.renderArea;
-		std::vector<VkRenderingAttachmentInfo> vk_color_attachment_infos{};
-		vk_color_attachment_infos.reserve(_activePass.colorAttachments.size());
-		for (const auto& attachment_info: _activePass.colorAttachments) {
-			vk_color_attachment_infos.push_back(attachment_info.getAsVkRenderingAttachmentInfo());
+		const bool hasDepth = _activePass->depthAttachment.has_value();
+		const VkRect2D renderArea = _activePass->renderArea;
+		ASSERT_MSG(_activePass->colorAttachments.size() <= kMaxColorAttachments, "Pass '{}' has too many color attachments!", _activePass->name);
+		// on the stack, this runs for every graphics pass of every frame
+		VkRenderingAttachmentInfo vk_color_attachment_infos[kMaxColorAttachments] = {};
+		for (size_t i = 0; i < _activePass->colorAttachments.size(); i++) {
+			vk_color_attachment_infos[i] = _activePass->colorAttachments[i].getAsVkRenderingAttachmentInfo();
 		}
 		VkRenderingAttachmentInfo vk_depth_attachment_info{};
 		if (hasDepth) {
-			vk_depth_attachment_info = _activePass.depthAttachment->getAsVkRenderingAttachmentInfo();
+			vk_depth_attachment_info = _activePass->depthAttachment->getAsVkRenderingAttachmentInfo();
 		}
 		const VkRenderingInfo info = {
 		    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
 		    .pNext = nullptr,
-		    .flags = 0,
+		    .flags = flags,
 		    .renderArea = renderArea,
 		    .layerCount = layerCount,
 		    .viewMask = viewMask,
-		    .colorAttachmentCount = static_cast<uint32_t>(_activePass.colorAttachments.size()),
-		    .pColorAttachments = vk_color_attachment_infos.data(),
+		    .colorAttachmentCount = static_cast<uint32_t>(_activePass->colorAttachments.size()),
+		    .pColorAttachments = vk_color_attachment_infos,
 		    .pDepthAttachment = hasDepth ? &vk_depth_attachment_info : nullptr,
 		    .pStencilAttachment = nullptr
 		};
@@ -644,6 +667,45 @@ namespace mythril {
 		vkCmdEndRendering(_wrapper->_cmdBuf);
 		_isRendering = false;
 	}
+	void CommandBuffer::beginSecondaryImpl(const CompiledPass& pass, bool isReusable) {
+		ASSERT_MSG(_isSecondary, "Only secondary command buffers can inherit a pass!");
+		const bool isGraphics = pass.type == PassDesc::Type::Graphics;
+		ASSERT_MSG(pass.colorAttachments.size() <= kMaxColorAttachments, "Pass '{}' has too many color attachments!", pass.name);
+		const VkCommandBufferInheritanceRenderingInfo rendering_info = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+		    .viewMask = pass.viewMask,
+		    .colorAttachmentCount = pass.formats.numColorFormats,
+		    .pColorAttachmentFormats = pass.formats.colorFormats.data(),
+		    .depthAttachmentFormat = pass.formats.depthFormat,
+		    .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+		    .rasterizationSamples = pass.sampleCount,
+		};
+		const VkCommandBufferInheritanceInfo inheritance_info = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		    .pNext = isGraphics ? &rendering_info : nullptr,
+		};
+		const VkCommandBufferBeginInfo bi = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		    .flags = (isReusable ? VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT : VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT) | (isGraphics ? VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0u),
+		    .pInheritanceInfo = &inheritance_info,
+		};
+		VK_CHECK(vkBeginCommandBuffer(_wrapper->_cmdBuf, &bi));
+		_activePass = &pass;
+		_viewMask = pass.viewMask;
+		if (isGraphics) {
+			// dynamic state isnt inherited, so every chunk starts out the way cmdBeginRenderingImpl leaves the primary
+			cmdSetViewportImpl(pass.renderArea.extent);
+			cmdSetScissorImpl(pass.renderArea.extent);
+			cmdBindDepthState({});
+			vkCmdSetDepthCompareOp(_wrapper->_cmdBuf, VK_COMPARE_OP_ALWAYS);
+			vkCmdSetDepthBiasEnable(_wrapper->_cmdBuf, VK_FALSE);
+			_isRendering = true;
+		}
+	}
+	void CommandBuffer::endSecondaryImpl() {
+		_isRendering = false;
+		VK_CHECK(vkEndCommandBuffer(_wrapper->_cmdBuf));
+	}
 	void CommandBuffer::bufferBarrierImpl(BufferHandle bufhandle, VkPipelineStageFlags2 srcStage, VkPipelineStageFlags2 dstStage) {
 		auto& buf = _ctx->view(bufhandle);
 
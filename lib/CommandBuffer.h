@@ -46,6 +46,10 @@ namespace mythril {
 		};
 		CommandBuffer() = default;
 		explicit CommandBuffer(CTX* ctx, Type type);
+		// records onto a specific queue, used by the RenderGraph for async queue work
+		CommandBuffer(CTX* ctx, Type type, ImmediateCommands* queue);
+		// wraps a secondary handed out by ImmediateCommands::acquireSecondary, used for parallel pass recording
+		CommandBuffer(CTX* ctx, Type type, const ImmediateCommands::CommandBufferWrapper& secondary);
 		~CommandBuffer();
 
 		VkCommandBufferSubmitInfo requestSubmitInfo() const;
@@ -135,8 +139,12 @@ namespace mythril {
 		void cmdBindPipelineImpl(const PipelineCoreData* common, VkPipelineBindPoint bindPoint);
 
 		// all functions that still have equivalent Vulkan commands but should be abstracted away from user
-		void cmdBeginRenderingImpl(uint32_t layerCount, uint32_t viewMask);
+		void cmdBeginRenderingImpl(uint32_t layerCount, uint32_t viewMask, VkRenderingFlags flags = 0);
 		void cmdEndRenderingImpl();
+		// secondaries inherit the pass' rendering instead of beginning their own
+		// reusable secondaries stay valid across frames in flight, parallel chunks are one time submits
+		void beginSecondaryImpl(const CompiledPass& pass, bool isReusable = false);
+		void endSecondaryImpl();
 
 		void cmdTransitionLayoutImpl(TextureHandle source, VkImageLayout currentLayout, VkImageLayout newLayout, VkImageSubresourceRange range);
 
@@ -164,7 +172,10 @@ namespace mythril {
 		// avoid lookup and store the common data
 		SharedPipelineInfo* _currentPipelineInfo = nullptr;
 		std::variant<GraphicsPipelineHandle, ComputePipelineHandle> _currentPipelineHandle;
-		CompiledPass _activePass;
+		// points into the RenderGraph's compiled passes, only valid while that pass is being recorded
+		const CompiledPass* _activePass = nullptr;
+		// only set for the dry run of a compile, unbuilt pipelines are collected here instead of built in place
+		std::vector<PendingPipelineBuild>* _pendingPipelines = nullptr;
 
 		bool _isRendering = false; // cmdBeginRendering
 
@@ -173,6 +184,7 @@ namespace mythril {
 		uint32_t _viewMask = 0;
 
 		bool _isDryRun = true; // for dummy CommandBuffer
+		bool _isSecondary = false; // recorded on a worker thread
 
 		friend class RenderGraph; // for access to set _activePass
 		friend class CTX; // for injection of command buffer data
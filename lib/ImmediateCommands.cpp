@@ -6,6 +6,7 @@
 #include "mythril/CTX.h"
 #include "Logger.h"
 #include "vkinfo.h"
+#include "vkutil.h"
 
 namespace mythril {
 	ImmediateCommands::ImmediateCommands(VkDevice device, uint32_t queueFamilyIndex, VkQueue vk_queue) :
@@ -24,6 +25,8 @@ namespace mythril {
 		    .queueFamilyIndex = queueFamilyIndex,
 		};
 		VK_CHECK(vkCreateCommandPool(device, &command_pool_ci, nullptr, &_vkCommandPool));
+		// per queue timeline, starts at 0 and is bumped by every submit
+		_vkTimelineSemaphore = vkutil::CreateTimelineSemaphore(device, 0);
 
 		// create command buffers
 		const VkCommandBufferAllocateInfo command_buffer_ai = {
@@ -58,7 +61,14 @@ namespace mythril {
 			vkDestroyFence(_vkDevice, buf._fence, nullptr);
 			vkDestroySemaphore(_vkDevice, buf._semaphore, nullptr);
 		}
+		vkDestroySemaphore(_vkDevice, _vkTimelineSemaphore, nullptr);
 		vkDestroyCommandPool(_vkDevice, _vkCommandPool, nullptr);
+		// destroying a pool frees its secondaries too
+		for (std::vector<SecondaryPool>& pools: _secondaryPools) {
+			for (SecondaryPool& pool: pools) {
+				vkDestroyCommandPool(_vkDevice, pool._vkCommandPool, nullptr);
+			}
+		}
 	}
 	const ImmediateCommands::CommandBufferWrapper& ImmediateCommands::acquire() {
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_ACQUIRE);
@@ -177,7 +187,7 @@ namespace mythril {
 		ASSERT_MSG(wrapper._isEncoding, "Command buffer must be encoding!");
 		VK_CHECK(vkEndCommandBuffer(wrapper._cmdBuf));
 
-		VkSemaphoreSubmitInfo waitSemaphores[] = {{}, {}};
+		VkSemaphoreSubmitInfo waitSemaphores[2 + kMaxTimelineWaits] = {};
 		uint32_t numWaitSemaphores = 0;
 		if (_waitSemaphore.semaphore) {
 			waitSemaphores[numWaitSemaphores++] = _waitSemaphore;
@@ -185,11 +195,15 @@ namespace mythril {
 		if (_lastSubmitSemaphore.semaphore) {
 			waitSemaphores[numWaitSemaphores++] = _lastSubmitSemaphore;
 		}
+		for (uint32_t i = 0; i < _numTimelineWaits; i++) {
+			waitSemaphores[numWaitSemaphores++] = _timelineWaits[i];
+		}
 		VkSemaphoreSubmitInfo signalSemaphores[] = {
 		    VkSemaphoreSubmitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .semaphore = wrapper._semaphore, .stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT},
+		    VkSemaphoreSubmitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .semaphore = _vkTimelineSemaphore, .value = ++_timelineValue, .stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT},
 		    {},
 		};
-		uint32_t numSignalSemaphores = 1;
+		uint32_t numSignalSemaphores = 2;
 		if (_signalSemaphore.semaphore) {
 			signalSemaphores[numSignalSemaphores++] = _signalSemaphore;
 		}
@@ -213,6 +227,7 @@ namespace mythril {
 		_lastSubmitHandle = wrapper._handle;
 		_waitSemaphore.semaphore = VK_NULL_HANDLE;
 		_signalSemaphore.semaphore = VK_NULL_HANDLE;
+		_numTimelineWaits = 0;
 
 		// reset
 		const_cast<CommandBufferWrapper&>(wrapper)._isEncoding = false;
@@ -233,6 +248,72 @@ namespace mythril {
 		_signalSemaphore.semaphore = semaphore;
 		_signalSemaphore.value = signalValue;
 	}
+	void ImmediateCommands::waitTimelineSemaphore(VkSemaphore semaphore, uint64_t value) {
+		ASSERT(semaphore != VK_NULL_HANDLE);
+		// waiting twice on one timeline only needs the larger value
+		for (uint32_t i = 0; i < _numTimelineWaits; i++) {
+			if (_timelineWaits[i].semaphore == semaphore) {
+				_timelineWaits[i].value = std::max(_timelineWaits[i].value, value);
+				return;
+			}
+		}
+		ASSERT_MSG(_numTimelineWaits < kMaxTimelineWaits, "Too many timeline waits queued for a single submit!");
+		_timelineWaits[_numTimelineWaits++] = {
+		    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		    .semaphore = semaphore,
+		    .value = value,
+		    .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		};
+	}
+	void ImmediateCommands::beginSecondaryFrame(uint32_t numThreads) {
+		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_ACQUIRE);
+		// the last frame has been submitted by now, so everything that executed its secondaries is covered
+		_secondaryFrameValues[_secondaryFrame] = _timelineValue;
+		_secondaryFrame = (_secondaryFrame + 1) % kMaxSecondaryFrames;
+		const uint64_t waitValue = _secondaryFrameValues[_secondaryFrame];
+		if (waitValue) {
+			const VkSemaphoreWaitInfo wait_info = {
+			    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+			    .semaphoreCount = 1,
+			    .pSemaphores = &_vkTimelineSemaphore,
+			    .pValues = &waitValue,
+			};
+			VK_CHECK(vkWaitSemaphores(_vkDevice, &wait_info, UINT64_MAX));
+		}
+		std::vector<SecondaryPool>& pools = _secondaryPools[_secondaryFrame];
+		if (pools.size() < numThreads)
+			pools.resize(numThreads);
+		for (SecondaryPool& pool: pools) {
+			if (pool._vkCommandPool == VK_NULL_HANDLE) {
+				const VkCommandPoolCreateInfo command_pool_ci = {
+				    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				    .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				    .queueFamilyIndex = _queueFamilyIndex,
+				};
+				VK_CHECK(vkCreateCommandPool(_vkDevice, &command_pool_ci, nullptr, &pool._vkCommandPool));
+			} else if (pool._numUsed) {
+				VK_CHECK(vkResetCommandPool(_vkDevice, pool._vkCommandPool, 0));
+			}
+			pool._numUsed = 0;
+		}
+	}
+	const ImmediateCommands::CommandBufferWrapper& ImmediateCommands::acquireSecondary(uint32_t threadIdx) {
+		std::vector<SecondaryPool>& pools = _secondaryPools[_secondaryFrame];
+		ASSERT_MSG(threadIdx < pools.size(), "Thread {} requested a secondary command buffer without a matching beginSecondaryFrame()!", threadIdx);
+		SecondaryPool& pool = pools[threadIdx];
+		if (pool._numUsed == pool._buffers.size()) {
+			CommandBufferWrapper& buf = pool._buffers.emplace_back();
+			const VkCommandBufferAllocateInfo command_buffer_ai = {
+			    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			    .commandPool = pool._vkCommandPool,
+			    .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			    .commandBufferCount = 1,
+			};
+			VK_CHECK(vkAllocateCommandBuffers(_vkDevice, &command_buffer_ai, &buf._cmdBufAllocated));
+			buf._cmdBuf = buf._cmdBufAllocated;
+		}
+		return pool._buffers[pool._numUsed++];
+	}
 	VkFence ImmediateCommands::getVkFence(SubmitHandle handle) const {
 		if (handle.empty()) {
 			return VK_NULL_HANDLE;
@@ -7,13 +7,18 @@
 #include "HelperMacros.h"
 #include "SubmitHandle.h"
 
+#include <array>
+#include <deque>
 #include <utility>
+#include <vector>
 #include <volk.h>
 
 namespace mythril {
 	class ImmediateCommands final {
 	public:
 		static constexpr uint32_t kMaxCommandBuffers = 64; // overkill lvk
+		static constexpr uint32_t kMaxTimelineWaits = 4;
+		static constexpr uint32_t kMaxSecondaryFrames = 3;
 		struct CommandBufferWrapper {
 			VkCommandBuffer _cmdBuf = VK_NULL_HANDLE;
 			VkCommandBuffer _cmdBufAllocated = VK_NULL_HANDLE;
@@ -42,12 +47,27 @@ namespace mythril {
 		void waitSemaphore(VkSemaphore semaphore);
 		void signalSemaphore(VkSemaphore semaphore, uint64_t signalValue);
 
+		// waits are consumed by the next submit, same as waitSemaphore()
 		void waitTimelineSemaphore(VkSemaphore semaphore, uint64_t value);
 
 		VkSemaphore acquireLastSubmitSemaphore() { return std::exchange(_lastSubmitSemaphore.semaphore, VK_NULL_HANDLE); }
+		// takes back a pending binary wait so it can be handed to a later submit
+		VkSemaphore acquireWaitSemaphore() { return std::exchange(_waitSemaphore.semaphore, VK_NULL_HANDLE); }
 		SubmitHandle getLastSubmitHandle() const { return _lastSubmitHandle; };
 		SubmitHandle getNextSubmitHandle() const { return _nextSubmitHandle; };
 
+		// every submit signals this queue's own timeline with an increasing value,
+		// other queues wait on it for cross-queue ordering
+		VkSemaphore getTimelineSemaphore() const { return _vkTimelineSemaphore; }
+		uint64_t getLastTimelineValue() const { return _timelineValue; }
+		uint32_t getQueueFamilyIndex() const { return _queueFamilyIndex; }
+
+		// secondaries come from per thread pools which are reset all at once, one set of pools per frame in flight
+		// call once per frame from the submitting thread, before any acquireSecondary() of that frame
+		void beginSecondaryFrame(uint32_t numThreads);
+		// safe to call concurrently as long as every thread passes its own index, the buffer is not begun yet
+		const CommandBufferWrapper& acquireSecondary(uint32_t threadIdx);
+
 	private:
 		void _purge();
 
@@ -59,6 +79,11 @@ namespace mythril {
 		VkSemaphoreSubmitInfo _lastSubmitSemaphore = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
 		VkSemaphoreSubmitInfo _waitSemaphore = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
 		VkSemaphoreSubmitInfo _signalSemaphore = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, .stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+		VkSemaphoreSubmitInfo _timelineWaits[kMaxTimelineWaits] = {};
+		uint32_t _numTimelineWaits = 0;
+
+		VkSemaphore _vkTimelineSemaphore = VK_NULL_HANDLE;
+		uint64_t _timelineValue = 0;
 
 		VkQueue _vkQueue = VK_NULL_HANDLE;
 		uint32_t _queueFamilyIndex = MYTHRIL_INVALID_U32;
@@ -69,6 +94,18 @@ namespace mythril {
 		SubmitHandle _nextSubmitHandle = SubmitHandle();
 
 		uint32_t _numAvailableCommandBuffers = kMaxCommandBuffers;
+
+		struct SecondaryPool {
+			VkCommandPool _vkCommandPool = VK_NULL_HANDLE;
+			// deque so handed out wrappers stay put while the pool grows
+			std::deque<CommandBufferWrapper> _buffers;
+			uint32_t _numUsed = 0;
+		};
+		// [frame][thread]
+		std::array<std::vector<SecondaryPool>, kMaxSecondaryFrames> _secondaryPools;
+		// timeline value covering every primary that executed the frame's secondaries
+		std::array<uint64_t, kMaxSecondaryFrames> _secondaryFrameValues = {};
+		uint32_t _secondaryFrame = 0;
 		uint32_t _submitCounter = 1;
 
 		friend class CommandBuffer;
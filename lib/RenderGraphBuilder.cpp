@@ -9,19 +9,34 @@
 #include "mythril/RenderGraphBuilder.h"
 
 #include <array>
+#include <bit>
 #include <cstdlib>
 #include <fstream>
+#include <map>
+#include <optional>
 #include <queue>
+#include <unordered_set>
 
 #include "RenderGraphInternal.h"
 
+#include "AllocationTracker.h"
 #include "GraphicsPipelineBuilder.h"
 #include "Logger.h"
 #include "vkstring.h"
 
 namespace mythril {
 	RenderGraph::RenderGraph() = default;
-	RenderGraph::~RenderGraph() = default;
+	RenderGraph::~RenderGraph() {
+		destroySplitEvents();
+		destroyTimestampPool();
+		invalidateStaticPasses();
+		// transient textures destroy themselves through CTX right after, their shared memory goes the same deferred route
+		if (!_transientCtx)
+			return;
+		for (VmaAllocation allocation: _transientAllocations) {
+			_transientCtx->deferTask(std::packaged_task<void()>([vma = _transientCtx->_vmaAllocator, allocation]() { vmaFreeMemory(vma, allocation); }));
+		}
+	}
 	RenderGraph::RenderGraph(RenderGraph&&) noexcept = default;
 	RenderGraph& RenderGraph::operator=(RenderGraph&&) noexcept = default;
 
@@ -53,6 +68,8 @@ namespace mythril {
 
 		add(base._passSource, src, Layout::TRANSFER_SRC);
 		add(base._passSource, dst, Layout::TRANSFER_DST);
+		// vkCmdBlitImage is graphics queue only
+		base._passSource.queue = QueueAffinity::Graphics;
 
 		auto oldCallback = base._passSource.executeCallback;
 		if (dst.texture->isSwapchainImage()) {
@@ -79,6 +96,8 @@ namespace mythril {
 
 		auto oldCallback = base._passSource.executeCallback;
 		if (dst.texture->isSwapchainImage()) {
+			// the swapchain image is only ever owned by graphics
+			base._passSource.queue = QueueAffinity::Graphics;
 			base._passSource.executeCallback = [oldCallback, srcHandle](CommandBuffer& cmd) {
 				if (oldCallback)
 					oldCallback(cmd);
@@ -97,6 +116,8 @@ namespace mythril {
 	// todo: i have no clue how this just works immediately besides the fact we dont actually touch the base image + restore its original layout
 	IntermediateBuilder& IntermediateBuilder::generateMipmaps(const Texture& texture) {
 		TextureHandle handle = texture.handle();
+		// mip generation is a chain of blits, graphics queue only
+		base._passSource.queue = QueueAffinity::Graphics;
 		auto oldCallback = base._passSource.executeCallback;
 		base._passSource.executeCallback = [oldCallback, handle](CommandBuffer& cmd) {
 			if (oldCallback)
@@ -109,9 +130,14 @@ namespace mythril {
 		add(base._passSource, buffer, access);
 		return *this;
 	}
+	IntermediateBuilder& IntermediateBuilder::dependency(Buffer& buffer, BufferAccess access, VkDeviceSize offset, VkDeviceSize size) {
+		add(base._passSource, buffer, access, offset, size);
+		return *this;
+	}
 	IntermediateBuilder& IntermediateBuilder::update(Buffer& buffer, std::function<UploadData()> dataCb, size_t dstOffset) {
 		BufferHandle handle = buffer.handle();
-		add(base._passSource, buffer, BufferAccess::TransferWrite);
+		// the size is only known once the callback runs, so everything from dstOffset on
+		add(base._passSource, buffer, BufferAccess::TransferWrite, dstOffset, VK_WHOLE_SIZE);
 
 		auto oldCallback = base._passSource.executeCallback;
 		base._passSource.executeCallback = [oldCallback, handle, dataCb = std::move(dataCb), dstOffset](CommandBuffer& cmd) {
@@ -136,7 +162,7 @@ namespace mythril {
 	}
 	IntermediateBuilder& IntermediateBuilder::upload(Buffer& buffer, std::function<UploadData()> dataCb, size_t dstOffset) {
 		BufferHandle handle = buffer.handle();
-		add(base._passSource, buffer, BufferAccess::TransferWrite);
+		add(base._passSource, buffer, BufferAccess::TransferWrite, dstOffset, VK_WHOLE_SIZE);
 
 		auto oldCallback = base._passSource.executeCallback;
 		base._passSource.executeCallback = [oldCallback, handle, dataCb = std::move(dataCb), dstOffset](CommandBuffer& cmd) {
@@ -170,11 +196,62 @@ namespace mythril {
 		this->base._rGraph._hasCompiled = false;
 	}
 
+	Texture& RenderGraph::createTransient(CTX& rCtx, const TextureSpec& spec) {
+		ASSERT_MSG(!_transientCtx || _transientCtx == &rCtx, "All transient textures of a RenderGraph must come from the same CTX!");
+		_transientCtx = &rCtx;
+		TransientTexture& transient = _transientTextures.emplace_back();
+		transient.texture = Texture{&rCtx, rCtx.createTextureFromSpecImpl(spec, true)};
+		transient.name = spec.debugName;
+		transient.spec = spec;
+		transient.spec.debugName = transient.name.c_str();
+		transient.spec.initialData = nullptr;
+		_hasCompiled = false;
+		return transient.texture;
+	}
+
+	void RenderGraph::markOutput(const Texture& texture) {
+		ASSERT_MSG(texture.valid(), "RenderGraph::markOutput called with an invalid texture.");
+		_outputTextures.push_back(texture.handle());
+		_hasCompiled = false;
+	}
+	void RenderGraph::markOutput(const Buffer& buffer) {
+		ASSERT_MSG(buffer.valid(), "RenderGraph::markOutput called with an invalid buffer.");
+		_outputBuffers.push_back(buffer.handle());
+		_hasCompiled = false;
+	}
+	void RenderGraph::setAutoAsyncCompute(bool enable) {
+		_autoAsyncCompute = enable;
+		_hasCompiled = false;
+	}
+	void RenderGraph::setPassTimingsEnabled(bool enable) {
+		_passTimingsEnabled = enable;
+		_hasCompiled = false;
+	}
+	void RenderGraph::setInferAttachmentOps(bool enable) {
+		_inferAttachmentOps = enable;
+		_hasCompiled = false;
+	}
+	void RenderGraph::setTextureVersioning(bool enable) {
+		_textureVersioning = enable;
+		_hasCompiled = false;
+	}
+
 	void BasePassBuilder::setExecuteCallback(const std::function<void(CommandBuffer& cmd)>& callback) {
 		_passSource.executeCallback = callback;
 		_rGraph._passDescriptions.push_back(_passSource);
 		_rGraph._hasCompiled = false;
 	}
+	void BasePassBuilder::setParallelExecuteCallback(uint32_t chunkCount, const std::function<void(CommandBuffer& cmd, uint32_t chunk)>& callback) {
+		ASSERT_MSG(chunkCount > 0, "Pass '{}' needs at least one chunk to execute in parallel!", _passSource.name);
+		ASSERT_MSG(!_passSource.isStatic, "Pass '{}' has static content, it is only ever recorded once and cannot be executed in parallel!", _passSource.name);
+		_passSource.parallelCallback = callback;
+		_passSource.chunkCount = chunkCount;
+		// the dry run and any single threaded recording just walk the chunks in order
+		setExecuteCallback([callback, chunkCount](CommandBuffer& cmd) {
+			for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+				callback(cmd, chunk);
+		});
+	}
 
 	static constexpr bool IsAttachmentImageLayout(VkImageLayout layout) {
 		switch (layout) {
@@ -309,6 +386,100 @@ namespace mythril {
 		}
 		ASSERT_MSG(false, "Unsupported BufferAccess value.");
 	}
+	// brings every subresource the request overlaps into the requested state, only emitting barriers where needed
+	// the overlap query draws from the same allocator as outBarriers, so frame arena callers stay off the heap
+	template<typename Alloc>
+	static void AppendImageBarriers(TextureStateTracker& tracker, const CompiledImageBarrier& req, VkImage image, VkFormat format, std::vector<VkImageMemoryBarrier2, Alloc>& outBarriers) {
+		using EntryAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<TextureStateTracker::SubresourceEntry>;
+		for (const auto& current: tracker.getOverlappingStates(req.range, EntryAlloc(outBarriers.get_allocator()))) {
+			if (!NeedsBarrier(current.state, req.dstLayout, req.dstMask))
+				continue;
+			outBarriers.push_back(
+			        {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			         .srcStageMask = current.state.mask.stage,
+			         .srcAccessMask = current.state.mask.access,
+			         .dstStageMask = req.dstMask.stage,
+			         .dstAccessMask = req.dstMask.access,
+			         .oldLayout = current.state.layout,
+			         .newLayout = req.dstLayout,
+			         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			         .image = image,
+			         .subresourceRange = MakeVkRange(format, current.range)}
+			);
+		}
+		tracker.setState(req.range, {req.dstLayout, req.dstMask});
+	}
+	// one barrier per interval of the requested bytes that conflicts, clipped to the buffer since intervals run to VK_WHOLE_SIZE
+	template<typename Alloc>
+	static void AppendBufferBarrier(BufferStateTracker& tracker, const CompiledBufferBarrier& req, VkBuffer buffer, VkDeviceSize bufferSize, std::vector<VkBufferMemoryBarrier2, Alloc>& outBarriers) {
+		using IntervalAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<BufferStateTracker::Interval>;
+		for (const BufferStateTracker::Interval& current: tracker.getOverlappingStates(req.offset, req.end, IntervalAlloc(outBarriers.get_allocator()))) {
+			if (current.begin >= bufferSize || !NeedsBufferBarrier(current.state, req.dstMask))
+				continue;
+			outBarriers.push_back({
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+				.srcStageMask = current.state.stage,
+				.srcAccessMask = current.state.access,
+				.dstStageMask = req.dstMask.stage,
+				.dstAccessMask = req.dstMask.access,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.buffer = buffer,
+				.offset = current.begin,
+				.size = std::min(current.end, bufferSize) - current.begin}
+			);
+		}
+		tracker.setState(req.offset, req.end, req.dstMask);
+	}
+	// async families can only execute a subset of the pipeline, strip whatever the queue cant see
+	// a mask that ends up empty becomes a full memory dependency so the barrier stays valid
+	static vkutil::StageAccess MaskStageAccessForQueue(const vkutil::StageAccess& mask, QueueAffinity queue) {
+		constexpr VkPipelineStageFlags2 commonStages = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_2_HOST_BIT;
+		constexpr VkAccessFlags2 commonAccess = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_HOST_READ_BIT | VK_ACCESS_2_HOST_WRITE_BIT;
+		constexpr VkAccessFlags2 transferAccess = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+		VkPipelineStageFlags2 allowedStages = 0;
+		VkAccessFlags2 allowedAccess = 0;
+		switch (queue) {
+			case QueueAffinity::Graphics:
+				return mask;
+			case QueueAffinity::AsyncCompute:
+				allowedStages = commonStages | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+				allowedAccess = commonAccess | transferAccess | VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT |
+				                VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_UNIFORM_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+				break;
+			case QueueAffinity::AsyncTransfer:
+				allowedStages = commonStages | VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+				allowedAccess = commonAccess | transferAccess;
+				break;
+		}
+		const vkutil::StageAccess result = {.stage = mask.stage & allowedStages, .access = mask.access & allowedAccess};
+		if (result.stage == 0)
+			return {.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
+		return result;
+	}
+
+	static VkImageLayout GetDependencyLayout(Layout simpleLayout) {
+		switch (simpleLayout) {
+			case Layout::GENERAL:
+				return VK_IMAGE_LAYOUT_GENERAL;
+			case Layout::READ:
+				return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			case Layout::TRANSFER_SRC:
+				return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			case Layout::TRANSFER_DST:
+				return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			case Layout::PRESENT:
+				return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			default:
+				assert(false);
+				return VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+	static VkImageLayout GetAttachmentLayout(const AllocatedTexture& texture) {
+		return texture.isDepthAttachment() ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
 
 	void RenderGraph::processResourceAccess(const TextureDesc& texDesc, VkImageLayout desiredLayout, CompiledPass& outPass, std::string_view passName) {
 		const AllocatedTexture& texture = texDesc.texture.view();
@@ -323,27 +494,10 @@ namespace mythril {
 		outPass.imageBarriers.reserve(passDesc.textureDependencyOperations.size() + passDesc.attachmentOperations.size());
 		outPass.bufferBarriers.reserve(passDesc.bufferDependencyOperations.size());
 		for (const TextureDependencyDesc& dependency_desc: passDesc.textureDependencyOperations) {
-			const VkImageLayout layout = [](const Layout simpleLayout) {
-				switch (simpleLayout) {
-					case Layout::GENERAL:
-						return VK_IMAGE_LAYOUT_GENERAL;
-					case Layout::READ:
-						return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-					case Layout::TRANSFER_SRC:
-						return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-					case Layout::TRANSFER_DST:
-						return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-					case Layout::PRESENT:
-						return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-					default:
-						assert(false);
-				}
-			}(dependency_desc.desiredLayout);
-			processResourceAccess(dependency_desc.texDesc, layout, outPass, passDesc.name);
+			processResourceAccess(dependency_desc.texDesc, GetDependencyLayout(dependency_desc.desiredLayout), outPass, passDesc.name);
 		}
 		for (const AttachmentDesc& attachment_desc: passDesc.attachmentOperations) {
-			const AllocatedTexture& texture = attachment_desc.texDesc.texture.view();
-			const VkImageLayout layout = texture.isDepthAttachment() ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			const VkImageLayout layout = GetAttachmentLayout(attachment_desc.texDesc.texture.view());
 			processResourceAccess(attachment_desc.texDesc, layout, outPass, passDesc.name);
 
 			if (attachment_desc.resolveTexDesc.has_value()) {
@@ -351,13 +505,45 @@ namespace mythril {
 			}
 		}
 		for (const BufferDependencyDesc& dependency_desc: passDesc.bufferDependencyOperations) {
-			outPass.bufferBarriers.push_back({.handle = dependency_desc.buffer.handle(), .dstMask = GetBufferStageAccess(dependency_desc.access, passDesc.type)});
+			const VkDeviceSize end = dependency_desc.size == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : dependency_desc.offset + dependency_desc.size;
+			outPass.bufferBarriers.push_back({.handle = dependency_desc.buffer.handle(), .dstMask = GetBufferStageAccess(dependency_desc.access, passDesc.type), .offset = dependency_desc.offset, .end = end});
+		}
+	}
+
+	// swapchain attachments are rebound every frame, so they are identified by the swapchain rather than the current image
+	static VkImage GetAttachmentIdentity(const AllocatedTexture& texture, VkImage swapchainIdentity) {
+		return texture.isSwapchainImage() ? swapchainIdentity : texture.getImage();
+	}
+	static bool AreAttachmentsStale(const PassDesc& passDesc, const CompiledPass& pass, VkImage swapchainIdentity) {
+		size_t i = 0;
+		for (const AttachmentDesc& attachment_desc: passDesc.attachmentOperations) {
+			if (i >= pass.attachmentImages.size() || pass.attachmentImages[i++] != GetAttachmentIdentity(attachment_desc.texDesc.texture.view(), swapchainIdentity))
+				return true;
+			if (attachment_desc.resolveTexDesc.has_value()) {
+				if (i >= pass.attachmentImages.size() || pass.attachmentImages[i++] != GetAttachmentIdentity(attachment_desc.resolveTexDesc->texture.view(), swapchainIdentity))
+					return true;
+			}
 		}
+		return false;
 	}
 
+	// the subresource views processAttachments will ask for, creating them up front leaves it only lookups
+	static void CreateAttachmentViews(const PassDesc& pass_desc) {
+		for (const AttachmentDesc& attachment_desc: pass_desc.attachmentOperations) {
+			ResolveImageView(attachment_desc.texDesc, attachment_desc.texDesc.texture.view(), pass_desc.name);
+			if (attachment_desc.resolveTexDesc.has_value())
+				ResolveImageView(attachment_desc.resolveTexDesc.value(), attachment_desc.resolveTexDesc->texture.view(), pass_desc.name);
+		}
+	}
 	void RenderGraph::processAttachments(const CTX& rCtx, const PassDesc& pass_desc, CompiledPass& outPass) {
 		if (pass_desc.attachmentOperations.empty())
 			return;
+		// can be redone on an already compiled pass, see refreshResources
+		outPass.colorAttachments.clear();
+		outPass.depthAttachment.reset();
+		outPass.formats = {};
+		outPass.attachmentImages.clear();
+		const VkImage swapchainIdentity = rCtx.isHeadless() ? VK_NULL_HANDLE : rCtx.view(rCtx._swapchain->getSwapchainTextureHandle(0)).getImage();
 		uint32_t max_width = 0, max_height = 0;
 		bool hasDepthAttachment = false;
 		for (const AttachmentDesc& attachment_desc: pass_desc.attachmentOperations) {
@@ -370,6 +556,7 @@ namespace mythril {
 				hasDepthAttachment = true;
 			}
 			VkImageView imageView = ResolveImageView(texDesc, allocatedTexture, pass_desc.name);
+			outPass.attachmentImages.push_back(GetAttachmentIdentity(allocatedTexture, swapchainIdentity));
 
 			const ClearValue& clear_value = attachment_desc.clearValue;
 			AttachmentInfo attachment_info = {
@@ -417,6 +604,7 @@ namespace mythril {
 				// set the fields we left empty previously
 				attachment_info.resolveImageLayout = attachment_info.imageLayout;
 				attachment_info.resolveImageView = ResolveImageView(resolve_desc, resolve_texture, pass_desc.name);
+				outPass.attachmentImages.push_back(GetAttachmentIdentity(resolve_texture, swapchainIdentity));
 			}
 			if (allocatedTexture.isSwapchainImage()) {
 				attachment_info.isSwapchainImage = true;
@@ -428,11 +616,16 @@ namespace mythril {
 				}
 			}
 
+			outPass.sampleCount = static_cast<VkSampleCountFlagBits>(allocatedTexture.getSampleCount());
 			// submit AttachmentInfo
-			if (isDepthAttachment)
+			if (isDepthAttachment) {
 				outPass.depthAttachment.emplace(attachment_info);
-			else
+				outPass.formats.depthFormat = attachment_info.imageFormat;
+			} else {
+				ASSERT_MSG(outPass.formats.numColorFormats < AttachmentFormats::kMaxColorFormats, "Pass '{}': Too many color attachments!", pass_desc.name);
 				outPass.colorAttachments.emplace_back(attachment_info);
+				outPass.formats.colorFormats[outPass.formats.numColorFormats++] = attachment_info.imageFormat;
+			}
 
 			// calculate the necessary dimensions of the vkCmdBeginRendering call
 			// thats all the below code does
@@ -449,21 +642,179 @@ namespace mythril {
 		outPass.renderArea = {{0, 0}, {max_width, max_height}};
 	}
 
+	// bytes a single load or store of the attachment moves, every sample of every layer of its mip
+	static uint64_t GetAttachmentTrafficBytes(const AllocatedTexture& texture, const SubresourceRange& range) {
+		const Dimensions dims = texture.getDimensions();
+		const uint64_t width = std::max(1u, dims.width >> range.baseMip);
+		const uint64_t height = std::max(1u, dims.height >> range.baseMip);
+		return width * height * range.numLayers * texture.getSampleCount() * vkutil::GetBytesPerPixel(texture.getFormat());
+	}
+
+	// walks the compiled order and rewrites the ops processAttachments copied from the AttachmentDesc
+	// loads only happen when something earlier in the frame wrote the attachment or it is sampled as history, otherwise the hand set op stays
+	// stores only happen when something later reads it, it leaves the graph, or an earlier pass reads it as history
+	// resolved MSAA targets nobody samples end up never touching memory
+	void RenderGraph::inferAttachmentOps() {
+		_attachmentBytesSaved = 0;
+		if (!_inferAttachmentOps)
+			return;
+		enum class AccessKind : uint8_t {
+			Read,
+			Write,
+			ReadWrite,
+			Attachment,
+			Resolve,
+		};
+		struct Access {
+			uint32_t order;
+			SubresourceRange range;
+			AccessKind kind;
+			// only for AccessKind::Attachment, the op it ended up with
+			AttachmentInfo* attachment = nullptr;
+		};
+		std::unordered_map<TextureHandle, std::vector<Access>> accesses;
+		struct InferredAttachment {
+			uint32_t order;
+			const AttachmentDesc* desc;
+			AttachmentInfo* info;
+			SubresourceRange range;
+		};
+		std::vector<InferredAttachment> attachments;
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(_compiledPasses.size()); ++i) {
+			CompiledPass& pass = _compiledPasses[i];
+			const PassDesc& pass_desc = _passDescriptions[pass.passIndex];
+			for (const TextureDependencyDesc& dependency_desc: pass_desc.textureDependencyOperations) {
+				const AccessKind kind = dependency_desc.desiredLayout == Layout::GENERAL ? AccessKind::ReadWrite : dependency_desc.desiredLayout == Layout::TRANSFER_DST ? AccessKind::Write : AccessKind::Read;
+				const TextureDesc& texDesc = dependency_desc.texDesc;
+				accesses[texDesc.texture.handle()].push_back({i, ResolveSubresourceRange(texDesc, texDesc.texture.view(), pass_desc.name), kind});
+			}
+			// same order processAttachments filled them in
+			uint32_t colorIdx = 0;
+			for (const AttachmentDesc& attachment_desc: pass_desc.attachmentOperations) {
+				const TextureDesc& texDesc = attachment_desc.texDesc;
+				const AllocatedTexture& texture = texDesc.texture.view();
+				AttachmentInfo* info = vkutil::IsFormatDepth(texture.getFormat()) ? &pass.depthAttachment.value() : &pass.colorAttachments[colorIdx++];
+				const SubresourceRange range = ResolveSubresourceRange(texDesc, texture, pass_desc.name);
+				accesses[texDesc.texture.handle()].push_back({i, range, AccessKind::Attachment, info});
+				attachments.push_back({i, &attachment_desc, info, range});
+				if (attachment_desc.resolveTexDesc.has_value()) {
+					const TextureDesc& resolve_desc = attachment_desc.resolveTexDesc.value();
+					accesses[resolve_desc.texture.handle()].push_back({i, ResolveSubresourceRange(resolve_desc, resolve_desc.texture.view(), pass_desc.name), AccessKind::Resolve});
+				}
+			}
+		}
+
+		// a pass earlier in the order samples it, which next frame means it reads what this frame left behind
+		// earlier attachments and resolves only overwrite it, they are not history
+		const auto isReadAsHistory = [](const std::vector<Access>& textureAccesses, uint32_t order, const SubresourceRange& range) {
+			return std::any_of(textureAccesses.begin(), textureAccesses.end(), [order, &range](const Access& access) {
+				return access.order < order && (access.kind == AccessKind::Read || access.kind == AccessKind::ReadWrite) && access.range.overlaps(range);
+			});
+		};
+		const auto isTransient = [this](TextureHandle handle) {
+			return std::any_of(_transientTextures.begin(), _transientTextures.end(), [handle](const TransientTexture& transient) { return transient.texture.handle() == handle; });
+		};
+		// loads first, a later attachment only reads its contents if it ended up loading them
+		for (const InferredAttachment& attachment: attachments) {
+			const TextureHandle handle = attachment.desc->texDesc.texture.handle();
+			if (attachment.desc->loadOp == LoadOp::CLEAR)
+				continue;
+			const std::vector<Access>& textureAccesses = accesses[handle];
+			const bool writtenBefore = std::any_of(textureAccesses.begin(), textureAccesses.end(), [&attachment](const Access& access) {
+				return access.order < attachment.order && access.kind != AccessKind::Read && access.range.overlaps(attachment.range);
+			});
+			if (writtenBefore) {
+				attachment.info->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+				continue;
+			}
+			// nothing in the frame wrote it, only textures the graph owns or that get replaced every frame have nothing worth keeping
+			if (isTransient(handle) || attachment.desc->texDesc.texture.view().isSwapchainImage()) {
+				attachment.info->loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				continue;
+			}
+			// sampled before anything wrote it means it carries last frame's contents, so this one builds on them too
+			if (isReadAsHistory(textureAccesses, attachment.order, attachment.range))
+				attachment.info->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			// otherwise nothing says the contents are needed or not, whatever was set by hand stays
+		}
+		uint64_t bytesSaved = 0, bytesAdded = 0;
+		for (const InferredAttachment& attachment: attachments) {
+			const TextureHandle handle = attachment.desc->texDesc.texture.handle();
+			const AllocatedTexture& texture = attachment.desc->texDesc.texture.view();
+			const std::vector<Access>& textureAccesses = accesses[handle];
+			const bool readAfter = std::any_of(textureAccesses.begin(), textureAccesses.end(), [&attachment](const Access& access) {
+				if (access.order <= attachment.order || !access.range.overlaps(attachment.range))
+					return false;
+				if (access.kind == AccessKind::Attachment)
+					return access.attachment->loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+				return access.kind == AccessKind::Read || access.kind == AccessKind::ReadWrite;
+			});
+			const bool readBefore = !isTransient(handle) && isReadAsHistory(textureAccesses, attachment.order, attachment.range);
+			const bool isOutput = texture.isSwapchainImage() || std::find(_outputTextures.begin(), _outputTextures.end(), handle) != _outputTextures.end();
+			attachment.info->storeOp = readAfter || readBefore || isOutput ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+			// compare against what was set by hand, negative differences are bugs the inference fixed
+			const uint64_t bytes = GetAttachmentTrafficBytes(texture, attachment.range);
+			const uint32_t handTraffic = (attachment.desc->loadOp == LoadOp::LOAD) + (attachment.desc->storeOp == StoreOp::STORE);
+			const uint32_t inferredTraffic = (attachment.info->loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) + (attachment.info->storeOp == VK_ATTACHMENT_STORE_OP_STORE);
+			if (handTraffic > inferredTraffic)
+				bytesSaved += bytes * (handTraffic - inferredTraffic);
+			else
+				bytesAdded += bytes * (inferredTraffic - handTraffic);
+		}
+		_attachmentBytesSaved = bytesSaved;
+		LOG_SYSTEM(LogType::Info, "Inferred attachment ops save {} bytes of attachment traffic per frame ({} bytes added where contents were needed).", bytesSaved, bytesAdded);
+	}
+
 	void RenderGraph::performDryRun(CTX& rCtx) {
 		// preserve any in-flight command buffer (e.g. when compile() is triggered from inside
 		// execute() after acquireCommand() has installed the real cmd buffer).
 		const CommandBuffer saved = rCtx._currentCommandBuffer;
+		std::vector<PendingPipelineBuild> pendingPipelines;
 		for (const CompiledPass& pass: _compiledPasses) {
 			// by default CommandBuffer will have _isDryRun = true
 			CommandBuffer dryCmd;
 			dryCmd._ctx = &rCtx;
-			dryCmd._activePass = pass;
+			dryCmd._activePass = &pass;
 			dryCmd._viewMask = pass.viewMask;
+			dryCmd._pendingPipelines = &pendingPipelines;
 			rCtx._currentCommandBuffer = dryCmd;
 			ASSERT_MSG(pass.executeCallback != nullptr, "Pass '{}' doesn't have an execute callback, something went horribly wrong!", pass.name);
+			swapTextureVersions(pass);
 			pass.executeCallback(dryCmd);
+			swapTextureVersions(pass);
 		}
 		rCtx._currentCommandBuffer = saved;
+
+		// building is the slow part of the dry run and every pipeline builds on its own, so they go wide
+		// the first pass to bind a pipeline decides its formats, same as when they were built in place
+		struct PipelineBuild {
+			AllocatedGraphicsPipeline* graphics;
+			AllocatedComputePipeline* compute;
+			const PendingPipelineBuild* pending;
+		};
+		std::vector<PipelineBuild> builds;
+		std::unordered_set<const void*> seen;
+		for (const PendingPipelineBuild& pending: pendingPipelines) {
+			AllocatedGraphicsPipeline* graphics = pending.graphics.valid() ? rCtx._graphicsPipelinePool.get(pending.graphics) : nullptr;
+			AllocatedComputePipeline* compute = pending.compute.valid() ? rCtx._computePipelinePool.get(pending.compute) : nullptr;
+			if (!graphics && !compute)
+				continue;
+			if (seen.insert(graphics ? static_cast<const void*>(graphics) : compute).second)
+				builds.push_back({graphics, compute, &pending});
+		}
+		if (builds.empty())
+			return;
+		rCtx.getWorkerPoolImpl().dispatch(static_cast<uint32_t>(builds.size()), [&rCtx, &builds](uint32_t task, uint32_t) {
+			const PipelineBuild& build = builds[task];
+			if (build.graphics)
+				rCtx.resolveGraphicsPipelineImpl(*build.graphics, build.pending->viewMask, build.pending->pass ? build.pending->pass->formats : AttachmentFormats{});
+			else
+				rCtx.resolveComputePipelineImpl(*build.compute);
+		});
+		++rCtx._commandEpoch;
+		LOG_SYSTEM(LogType::Info, "RenderGraph built {} pipelines across {} threads.", builds.size(), rCtx.getWorkerPoolImpl().getNumThreads());
 	}
 
 	bool isWrite(Layout layout) {
@@ -474,46 +825,64 @@ namespace mythril {
 	}
 
 
-	// unweighted, directed
-	// fixed vertex amount
-	template<size_t Vertices>
-	struct AdjacencyMatrix {
-		void addEdge(size_t x, size_t y) {
-			if (x >= Vertices || y >= Vertices) return;
-			size_t bitIndex = (y * Vertices) + x;
-			data.set(bitIndex);
-		}
-		void removeEdge(size_t x, size_t y) {
-			if (x >= Vertices || y >= Vertices) return;
-			size_t bitIndex = (y * Vertices) + x;
-			data.reset(bitIndex);
-		}
-		bool hasEdge(size_t x, size_t y) {
-			if (x >= Vertices || y >= Vertices) return false;
-			return data.test((y * Vertices) + x);
+	// one bit per pass (or per edge), whole words are tested and set at once
+	struct PassBitset {
+		std::vector<uint64_t> words;
+
+		explicit PassBitset(size_t bitCount) : words((bitCount + 63) / 64, 0) {}
+		void set(uint32_t bit) { words[bit >> 6] |= uint64_t{1} << (bit & 63); }
+		bool test(uint32_t bit) const { return (words[bit >> 6] >> (bit & 63)) & 1; }
+		size_t count() const {
+			size_t total = 0;
+			for (const uint64_t word : words)
+				total += static_cast<size_t>(std::popcount(word));
+			return total;
 		}
-		std::bitset<Vertices * Vertices> data;
 	};
 
 	struct DirectedGraph {
 		size_t nodeCount;
 		// indicies represent original pass index
 		// predecessors[2] = {0, 1} represents the third pass that must wait until first and second run
-		// will always be same size vector as the # of passes
-		std::vector<std::unordered_set<uint32_t>> predecessors;
-		std::vector<std::vector<uint32_t>> successors;
+		// has a row for every pass, edges are unique and sorted
+		AdjacencyList predecessors;
+		AdjacencyList successors;
 		std::vector<uint32_t> inDegree;
 
-		explicit DirectedGraph(uint32_t vertexCount) : nodeCount(vertexCount), predecessors(vertexCount), successors(vertexCount), inDegree(vertexCount) {}
+		explicit DirectedGraph(uint32_t vertexCount) : nodeCount(vertexCount) {
+			predecessors.offsets.reserve(vertexCount + 1);
+		}
 
-		void addEdge(uint32_t from, uint32_t to) {
-			if (from == to) return;
-			predecessors.at(to).insert(from);
+		// rows are appended in pass order, the next one belongs to the pass after the last
+		void appendPredecessors(std::vector<uint32_t>& preds) {
+			std::sort(preds.begin(), preds.end());
+			preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+			predecessors.edges.insert(predecessors.edges.end(), preds.begin(), preds.end());
+			predecessors.offsets.push_back(static_cast<uint32_t>(predecessors.edges.size()));
+		}
+		// successors are the transpose of the predecessors, a counting pass sizes the rows and a second fills them
+		void finalize() {
+			inDegree.resize(nodeCount);
+			successors.offsets.assign(nodeCount + 1, 0);
+			for (uint32_t node = 0; node < nodeCount; ++node) {
+				inDegree[node] = predecessors.degree(node);
+				for (const uint32_t pred : predecessors[node])
+					successors.offsets[pred + 1]++;
+			}
+			for (size_t node = 0; node < nodeCount; ++node)
+				successors.offsets[node + 1] += successors.offsets[node];
+			successors.edges.resize(predecessors.edges.size());
+			std::vector<uint32_t> cursor(successors.offsets.begin(), successors.offsets.end() - 1);
+			for (uint32_t node = 0; node < nodeCount; ++node) {
+				for (const uint32_t pred : predecessors[node])
+					successors.edges[cursor[pred]++] = node;
+			}
 		}
 
 		std::optional<std::vector<uint32_t>> topologicalSort() const {
 			std::vector<uint32_t> local_in_degrees = inDegree;
-			std::queue<uint32_t> ready;
+			// lowest index first, so passes that dont depend on each other keep their declaration order
+			std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> ready;
 			std::vector<uint32_t> sorted_order;
 			sorted_order.reserve(this->nodeCount);
 
@@ -524,7 +893,7 @@ namespace mythril {
 			}
 			// process from root nodes
 			while (!ready.empty()) {
-				uint32_t node = ready.front(); ready.pop();
+				const uint32_t node = ready.top(); ready.pop();
 				sorted_order.push_back(node);
 				for (uint32_t successor : successors[node]) {
 					if (--local_in_degrees[successor] == 0)
@@ -537,75 +906,211 @@ namespace mythril {
 		}
 	};
 
-	DirectedGraph build_directed_graph(const std::vector<PassDesc>& pass_descs) {
+	// renamed_from maps a transient to the first pass desc using its second version, see selectTextureVersions
+	DirectedGraph build_directed_graph(const std::vector<PassDesc>& pass_descs, const std::unordered_map<TextureHandle, uint32_t>& renamed_from = {}) {
 		const size_t pass_desc_count = pass_descs.size();
 
-		auto collectTexAccess = [](const PassDesc& desc) {
-			std::vector<std::pair<TextureHandle, bool>> result;
-			result.reserve(desc.textureDependencyOperations.size() + desc.attachmentOperations.size());
+		struct TexAccess {
+			TextureHandle handle;
+			SubresourceRange range;
+			bool isWrite;
+		};
+		// scratch reused by every pass
+		std::vector<TexAccess> texAccesses;
+		auto collectTexAccess = [&texAccesses](const PassDesc& desc) -> const std::vector<TexAccess>& {
+			std::vector<TexAccess>& result = texAccesses;
+			result.clear();
+			auto push = [&](const TextureDesc& texDesc, bool isWrite) {
+				result.push_back({texDesc.texture.handle(), ResolveSubresourceRange(texDesc, texDesc.texture.view(), desc.name), isWrite});
+			};
 			for (const auto& texDep : desc.textureDependencyOperations) {
-				result.emplace_back(texDep.texDesc.texture.handle(), isWrite(texDep.desiredLayout));
+				push(texDep.texDesc, isWrite(texDep.desiredLayout));
 			}
 			for (const auto& attachDep : desc.attachmentOperations) {
 				// an attachment is always written to
-				result.emplace_back(attachDep.texDesc.texture.handle(), true);
+				push(attachDep.texDesc, true);
 				if (attachDep.resolveTexDesc.has_value())
-					result.emplace_back(attachDep.resolveTexDesc->texture.handle(), true);
+					push(attachDep.resolveTexDesc.value(), true);
 			}
 			return result;
 		};
-		auto collectBufAccess = [](const PassDesc& desc) {
-			std::vector<std::pair<BufferHandle, bool>> result;
-			result.reserve(desc.bufferDependencyOperations.size());
+		struct BufAccess {
+			BufferHandle handle;
+			VkDeviceSize begin;
+			VkDeviceSize end;
+			bool isWrite;
+		};
+		std::vector<BufAccess> bufAccesses;
+		auto collectBufAccess = [&bufAccesses](const PassDesc& desc) -> const std::vector<BufAccess>& {
+			std::vector<BufAccess>& result = bufAccesses;
+			result.clear();
 			for (const auto& bufDep : desc.bufferDependencyOperations) {
-				result.emplace_back(bufDep.buffer.handle(), isWrite(bufDep.access));
+				const VkDeviceSize end = bufDep.size == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : bufDep.offset + bufDep.size;
+				result.push_back({bufDep.buffer.handle(), bufDep.offset, end, isWrite(bufDep.access)});
 			}
 			return result;
 		};
 
 		// build our tracking vars
-		// where a handle represents a resource, the integar represents its pass_id
-		std::unordered_map<TextureHandle, uint32_t> lastTexWriter;
-		std::unordered_map<TextureHandle, std::vector<uint32_t>> lastTexReaders;
-
-		std::unordered_map<BufferHandle, uint32_t> lastBufWriter;
-		std::unordered_map<BufferHandle, std::vector<uint32_t>> lastBufReaders;
+		// resources get a dense id the first time a pass touches them, their state lives in flat arrays indexed by it
+		// textures are tracked per subresource range, so passes on disjoint mips/layers of one texture stay unordered
+		// writers are the writes nothing later has fully overwritten yet, readers the reads since then
+		// a read only looks at the writers, so any number of readers of one resource never scan each other
+		struct TexAccessRecord {
+			SubresourceRange range;
+			uint32_t passIdx;
+		};
+		struct TexResourceState {
+			std::vector<TexAccessRecord> writers;
+			std::vector<TexAccessRecord> readers;
+		};
+		// buffers the same way, per byte range
+		struct BufAccessRecord {
+			VkDeviceSize begin;
+			VkDeviceSize end;
+			uint32_t passIdx;
+		};
+		struct BufResourceState {
+			std::vector<BufAccessRecord> writers;
+			std::vector<BufAccessRecord> readers;
+		};
+		std::vector<TexResourceState> texStates;
+		std::vector<BufResourceState> bufStates;
+		// pool index to dense id, a second version gets ids of its own as it never touches the same memory as before the rename
+		std::vector<uint32_t> texIds;
+		std::vector<uint32_t> renamedTexIds;
+		std::vector<uint32_t> bufIds;
+		auto denseId = [](std::vector<uint32_t>& ids, uint32_t poolIndex, auto& states) {
+			if (poolIndex >= ids.size())
+				ids.resize(poolIndex + 1, UINT32_MAX);
+			if (ids[poolIndex] == UINT32_MAX) {
+				ids[poolIndex] = static_cast<uint32_t>(states.size());
+				states.emplace_back();
+			}
+			return ids[poolIndex];
+		};
 
-		DirectedGraph result(pass_desc_count);
+		DirectedGraph result(static_cast<uint32_t>(pass_desc_count));
+		// edges only ever point at the pass being visited, so each pass gathers its row and appends it in one go
+		std::vector<uint32_t> preds;
+		// the pass that last added an edge from each pass, so a row never gets the same edge twice
+		std::vector<uint32_t> edgeStamps(pass_desc_count, UINT32_MAX);
+		auto addEdge = [&preds, &edgeStamps](uint32_t from, uint32_t to) {
+			if (from == to || edgeStamps[from] == to)
+				return;
+			edgeStamps[from] = to;
+			preds.push_back(from);
+		};
 		// first collect all edges from the graph sequentially
-		for (int i = 0; i < pass_desc_count; i++) {
+		for (uint32_t i = 0; i < pass_desc_count; i++) {
 			const PassDesc& desc = pass_descs[i];
+			preds.clear();
 			// h = handle
 			// go through textures
-			for (const auto& [h, isWrite] : collectTexAccess(desc)) {
-				// if the resource isnt added already
-				if (auto it = lastTexWriter.find(h); it != lastTexWriter.end())
-					result.addEdge(it->second, i);
-
-				if (isWrite) {
-					// WAW
-					for (const uint32_t reader : lastTexReaders[h])
-						result.addEdge(reader, i);
-					lastTexWriter[h] = i;
-					lastTexReaders[h].clear();
-				} else {
-					// WAR
-					lastTexReaders[h].push_back(i);
+			for (const auto& [h, range, isWrite] : collectTexAccess(desc)) {
+				const auto renamed = renamed_from.empty() ? renamed_from.end() : renamed_from.find(h);
+				const bool isRenamed = renamed != renamed_from.end() && i >= renamed->second;
+				TexResourceState& state = texStates[denseId(isRenamed ? renamedTexIds : texIds, h.index(), texStates)];
+				// RAW and WAW
+				for (const TexAccessRecord& record : state.writers) {
+					if (record.range.overlaps(range))
+						addEdge(record.passIdx, i);
+				}
+				if (!isWrite) {
+					state.readers.push_back({range, i});
+					continue;
+				}
+				// WAR, then anything this write fully covers is ordered before it and later accesses only need the edge to us
+				for (const TexAccessRecord& record : state.readers) {
+					if (record.range.overlaps(range))
+						addEdge(record.passIdx, i);
 				}
+				auto isCovered = [&range](const TexAccessRecord& record) { return range.contains(record.range); };
+				std::erase_if(state.writers, isCovered);
+				std::erase_if(state.readers, isCovered);
+				state.writers.push_back({range, i});
 			}
 			// go through buffers
-			for (const auto& [h, isWrite] : collectBufAccess(desc)) {
-				if (auto it = lastBufWriter.find(h); it != lastBufWriter.end())
-					result.addEdge(it->second, i);
-				if (isWrite) {
-					for (const uint32_t reader : lastBufReaders[h])
-						result.addEdge(reader, i);
-					lastBufWriter[h] = i;
-					lastBufReaders[h].clear();
-				} else {
-					lastBufReaders[h].push_back(i);
+			for (const auto& [h, begin, end, isWrite] : collectBufAccess(desc)) {
+				BufResourceState& state = bufStates[denseId(bufIds, h.index(), bufStates)];
+				auto overlaps = [begin, end](const BufAccessRecord& record) { return record.end > begin && record.begin < end; };
+				for (const BufAccessRecord& record : state.writers) {
+					if (overlaps(record))
+						addEdge(record.passIdx, i);
 				}
+				if (!isWrite) {
+					state.readers.push_back({begin, end, i});
+					continue;
+				}
+				for (const BufAccessRecord& record : state.readers) {
+					if (overlaps(record))
+						addEdge(record.passIdx, i);
+				}
+				auto isCovered = [begin, end](const BufAccessRecord& record) { return record.begin >= begin && record.end <= end; };
+				std::erase_if(state.writers, isCovered);
+				std::erase_if(state.readers, isCovered);
+				state.writers.push_back({begin, end, i});
 			}
+			result.appendPredecessors(preds);
+		}
+		result.finalize();
+		return result;
+	}
+
+	// drops every edge p -> v that a longer path from p to v already implies, which keeps reachability and the longest paths
+	// a pred is redundant when it is an ancestor of another pred of the same pass. ancestors are bitsets over topological
+	// positions built with whole-word ors, a block of columns at a time so huge graphs dont need all n^2 bits at once
+	AdjacencyList reduce_transitive_edges(const AdjacencyList& predecessors, const std::vector<uint32_t>& topo_sorted_order) {
+		constexpr uint32_t kMaxBlockWords = 64;
+		const auto node_count = static_cast<uint32_t>(topo_sorted_order.size());
+		std::vector<uint32_t> position(node_count);
+		for (uint32_t i = 0; i < node_count; ++i)
+			position[topo_sorted_order[i]] = i;
+
+		PassBitset redundantEdges(predecessors.edges.size());
+		// [position - blockBegin], ancestors of the pass at each position that fall into the current block
+		std::vector<uint64_t> ancestors;
+		std::array<uint64_t, kMaxBlockWords> predAncestors{};
+		for (uint32_t blockBegin = 0; blockBegin < node_count; blockBegin += kMaxBlockWords * 64) {
+			const uint32_t blockWords = std::min(kMaxBlockWords, (node_count - blockBegin + 63) / 64);
+			const uint32_t blockEnd = std::min(blockBegin + blockWords * 64, node_count);
+			// ancestors sit earlier in the order, so passes before the block have none in it
+			ancestors.assign(static_cast<size_t>(node_count - blockBegin) * blockWords, 0);
+			for (uint32_t pos = blockBegin; pos < node_count; ++pos) {
+				const uint32_t node = topo_sorted_order[pos];
+				std::fill_n(predAncestors.begin(), blockWords, 0);
+				for (const uint32_t pred : predecessors[node]) {
+					const uint32_t predPos = position[pred];
+					if (predPos < blockBegin)
+						continue;
+					const uint64_t* predRow = &ancestors[static_cast<size_t>(predPos - blockBegin) * blockWords];
+					for (uint32_t w = 0; w < blockWords; ++w)
+						predAncestors[w] |= predRow[w];
+				}
+				uint64_t* row = &ancestors[static_cast<size_t>(pos - blockBegin) * blockWords];
+				for (uint32_t edge = predecessors.offsets[node]; edge < predecessors.offsets[node + 1]; ++edge) {
+					const uint32_t predPos = position[predecessors.edges[edge]];
+					if (predPos < blockBegin || predPos >= blockEnd)
+						continue;
+					const uint32_t bit = predPos - blockBegin;
+					if ((predAncestors[bit >> 6] >> (bit & 63)) & 1)
+						redundantEdges.set(edge);
+					row[bit >> 6] |= uint64_t{1} << (bit & 63);
+				}
+				for (uint32_t w = 0; w < blockWords; ++w)
+					row[w] |= predAncestors[w];
+			}
+		}
+
+		AdjacencyList result;
+		result.offsets.reserve(predecessors.offsets.size());
+		result.edges.reserve(predecessors.edges.size());
+		for (uint32_t node = 0; node + 1 < static_cast<uint32_t>(predecessors.offsets.size()); ++node) {
+			for (uint32_t edge = predecessors.offsets[node]; edge < predecessors.offsets[node + 1]; ++edge) {
+				if (!redundantEdges.test(edge))
+					result.edges.push_back(predecessors.edges[edge]);
+			}
+			result.offsets.push_back(static_cast<uint32_t>(result.edges.size()));
 		}
 		return result;
 	}
@@ -654,74 +1159,500 @@ namespace mythril {
 
 	std::vector<uint32_t> cull_unused_passes(
 		const std::vector<uint32_t>& topo_sorted_order,
-		const std::vector<std::unordered_set<uint32_t>>& predecessors,
-		const std::vector<PassDesc>& pass_descs) {
+		const AdjacencyList& predecessors,
+		const std::vector<PassDesc>& pass_descs,
+		const std::vector<TextureHandle>& output_textures,
+		const std::vector<BufferHandle>& output_buffers) {
 
 		const size_t node_count = topo_sorted_order.size();
-		// now that sortedOrder is topologically sorted, we can perform culling from the swapchain pass
-		// todo: this only walks back from a swapchain image, headless will mean everything is culled
-		std::unordered_set<uint32_t> sinkPasses;
+		// now that sortedOrder is topologically sorted, we can perform culling from every pass writing an output
+		// the swapchain is always an output, anything else has to be marked by the user
+		auto isOutput = [&output_textures](const Texture& texture) {
+			return texture->isSwapchainImage() || std::find(output_textures.begin(), output_textures.end(), texture.handle()) != output_textures.end();
+		};
+		// reachable starts out as the sinks
+		PassBitset reachablePasses(node_count);
 		for (uint32_t i = 0; i < node_count; i++) {
 			const PassDesc& pass_desc = pass_descs[i];
 			for (const auto& attachDesc : pass_desc.attachmentOperations) {
-				if (attachDesc.texDesc.texture->isSwapchainImage()) {
-					sinkPasses.insert(i);
+				if (isOutput(attachDesc.texDesc.texture) || (attachDesc.resolveTexDesc && isOutput(attachDesc.resolveTexDesc->texture))) {
+					reachablePasses.set(i);
 					break;
 				}
 			}
-			// verify that it is a write to swapchain not a read for some reason
+			// verify that it is a write to the output not a read for some reason
 			for (const auto& texDesc : pass_desc.textureDependencyOperations) {
-				if (texDesc.texDesc.texture->isSwapchainImage() && isWrite(texDesc.desiredLayout)) {
-					sinkPasses.insert(i);
+				if (isOutput(texDesc.texDesc.texture) && isWrite(texDesc.desiredLayout)) {
+					reachablePasses.set(i);
 					break;
 				}
 			}
-		}
-		// now reverse BFS
-		std::unordered_set<uint32_t> reachablePasses;
-		std::queue<uint32_t> worklist;
-		for (uint32_t sink : sinkPasses) {
-			worklist.push(sink);
-			reachablePasses.insert(sink);
-		}
-		while (!worklist.empty()) {
-			const uint32_t node = worklist.front(); worklist.pop();
-			for (uint32_t pred : predecessors[node]) {
-				if (reachablePasses.insert(pred).second)
-					worklist.push(pred);
+			for (const auto& bufDesc : pass_desc.bufferDependencyOperations) {
+				if (isWrite(bufDesc.access) && std::find(output_buffers.begin(), output_buffers.end(), bufDesc.buffer.handle()) != output_buffers.end()) {
+					reachablePasses.set(i);
+					break;
+				}
 			}
 		}
+		if (reachablePasses.count() == 0 && node_count > 0)
+			LOG_SYSTEM_NOSOURCE(LogType::Warning, "RenderGraph has no outputs, every pass will be culled! Write to the swapchain or use RenderGraph::markOutput().");
+		// walking the topological order backwards sees every successor of a pass before the pass itself
+		// so one sweep marks everything a sink depends on, no worklist needed
+		for (auto it = topo_sorted_order.rbegin(); it != topo_sorted_order.rend(); ++it) {
+			if (!reachablePasses.test(*it))
+				continue;
+			for (const uint32_t pred : predecessors[*it])
+				reachablePasses.set(pred);
+		}
 		// filter sortedOrder while preserving order
 		std::vector<uint32_t> result;
-		result.reserve(reachablePasses.size());
+		result.reserve(reachablePasses.count());
 		for (uint32_t passIdx : topo_sorted_order) {
-			if (reachablePasses.contains(passIdx))
+			if (reachablePasses.test(passIdx))
 				result.push_back(passIdx);
 		}
 		return result;
 	}
 
-	ExecutionSchedule calculate_execution_schedule(const std::vector<uint32_t>& culled_order, const std::vector<std::unordered_set<uint32_t>>& predecessors) {
+	ExecutionSchedule calculate_execution_schedule(const std::vector<uint32_t>& culled_order, const AdjacencyList& predecessors) {
 		ExecutionSchedule result;
 		uint32_t max_depth = 0;
+		// dense by pass index, culled passes stay at UINT32_MAX
+		std::vector<uint32_t> depths(predecessors.offsets.size() - 1, UINT32_MAX);
 		// find the depth for every active (culled) pass
 		for (const uint32_t pass_idx : culled_order) {
 			uint32_t current_depth = 0;
 			for (uint32_t pred : predecessors[pass_idx]) {
 				// only get predecessors that arent culled
-				if (auto it = result.pass_depths.find(pred); it != result.pass_depths.end()) {
-					current_depth = std::max(current_depth, it->second + 1);
-				}
+				if (depths[pred] != UINT32_MAX)
+					current_depth = std::max(current_depth, depths[pred] + 1);
 			}
-			result.pass_depths[pass_idx] = current_depth;
+			depths[pass_idx] = current_depth;
 			// update max if necessary
 			max_depth = std::max(max_depth, current_depth);
 		}
 		// group passes into layers
 		result.layers.resize(max_depth + 1);
+		result.pass_depths.reserve(culled_order.size());
 		for (const uint32_t pass_idx : culled_order) {
-			const uint32_t depth = result.pass_depths[pass_idx];
-			result.layers[depth].push_back(pass_idx);
+			result.pass_depths[pass_idx] = depths[pass_idx];
+			result.layers[depths[pass_idx]].push_back(pass_idx);
+		}
+		return result;
+	}
+
+	// length of the critical path in layers, culling is left out as it only compares renames against each other
+	uint32_t count_schedule_layers(const std::vector<PassDesc>& pass_descs, const std::unordered_map<TextureHandle, uint32_t>& renamed_from) {
+		const DirectedGraph graph = build_directed_graph(pass_descs, renamed_from);
+		const std::optional<std::vector<uint32_t>> sorted_order = graph.topologicalSort();
+		// compile reports the cycle
+		if (!sorted_order)
+			return UINT32_MAX;
+		return static_cast<uint32_t>(calculate_execution_schedule(sorted_order.value(), graph.predecessors).layers.size());
+	}
+
+	// rough cost of moving on to a pass given what the passes before it left behind
+	// tracked per resource rather than per subresource, its only used to compare orders against each other
+	// every access is flattened once onto dense resource ids, so scoring a pass is a walk over flat arrays
+	struct PassOrderSimulator {
+		static constexpr uint32_t kBarrierCost = 1;
+		static constexpr uint32_t kTransitionCost = 3;
+		static constexpr uint32_t kRenderTargetSwitchCost = 2;
+		// nothing used it yet, the first use of anything transitions it no matter where it lands so it doesnt count
+		static constexpr VkImageLayout kUnknownLayout = VK_IMAGE_LAYOUT_MAX_ENUM;
+		// a pass without render targets, or no graphics pass ran yet
+		static constexpr uint32_t kNoRenderTargets = UINT32_MAX;
+
+		struct TextureAccess {
+			uint32_t id;
+			VkImageLayout layout;
+			bool isWrite;
+		};
+		struct BufferAccess {
+			uint32_t id;
+			bool isWrite;
+		};
+		struct PassAccesses {
+			uint32_t textureBegin;
+			uint32_t textureEnd;
+			uint32_t bufferBegin;
+			uint32_t bufferEnd;
+			bool isGraphics;
+			// interned, two passes render to the same targets when their ids match
+			uint32_t renderTargets;
+		};
+		struct TextureState {
+			VkImageLayout layout = kUnknownLayout;
+			bool written = false;
+		};
+		struct BufferState {
+			bool known = false;
+			bool written = false;
+		};
+
+		// indexed by position in the order handed to the constructor
+		std::vector<PassAccesses> passes;
+		std::vector<TextureAccess> textureAccesses;
+		std::vector<BufferAccess> bufferAccesses;
+		std::vector<TextureState> textures;
+		std::vector<BufferState> buffers;
+		uint32_t renderTargets = kNoRenderTargets;
+
+		PassOrderSimulator(const std::vector<uint32_t>& order, const std::vector<PassDesc>& pass_descs) {
+			std::unordered_map<TextureHandle, uint32_t> texture_ids;
+			std::unordered_map<BufferHandle, uint32_t> buffer_ids;
+			std::map<std::vector<uint32_t>, uint32_t> render_target_ids;
+			// scratch reused by every pass, only copied when a new set of targets shows up
+			std::vector<uint32_t> targets;
+			auto textureId = [&texture_ids](TextureHandle handle) {
+				return texture_ids.try_emplace(handle, static_cast<uint32_t>(texture_ids.size())).first->second;
+			};
+			passes.reserve(order.size());
+			for (const uint32_t pass_idx : order) {
+				const PassDesc& desc = pass_descs[pass_idx];
+				PassAccesses& pass = passes.emplace_back();
+				pass.textureBegin = static_cast<uint32_t>(textureAccesses.size());
+				for (const TextureDependencyDesc& dependency_desc : desc.textureDependencyOperations)
+					textureAccesses.push_back({textureId(dependency_desc.texDesc.texture.handle()), GetDependencyLayout(dependency_desc.desiredLayout), isWrite(dependency_desc.desiredLayout)});
+				targets.clear();
+				for (const AttachmentDesc& attachment_desc : desc.attachmentOperations) {
+					const VkImageLayout layout = GetAttachmentLayout(attachment_desc.texDesc.texture.view());
+					targets.push_back(textureId(attachment_desc.texDesc.texture.handle()));
+					textureAccesses.push_back({targets.back(), layout, true});
+					if (attachment_desc.resolveTexDesc.has_value()) {
+						targets.push_back(textureId(attachment_desc.resolveTexDesc->texture.handle()));
+						textureAccesses.push_back({targets.back(), layout, true});
+					}
+				}
+				pass.textureEnd = static_cast<uint32_t>(textureAccesses.size());
+				pass.bufferBegin = static_cast<uint32_t>(bufferAccesses.size());
+				for (const BufferDependencyDesc& dependency_desc : desc.bufferDependencyOperations) {
+					const uint32_t id = buffer_ids.try_emplace(dependency_desc.buffer.handle(), static_cast<uint32_t>(buffer_ids.size())).first->second;
+					bufferAccesses.push_back({id, isWrite(dependency_desc.access)});
+				}
+				pass.bufferEnd = static_cast<uint32_t>(bufferAccesses.size());
+				pass.isGraphics = desc.type == PassDesc::Type::Graphics;
+				pass.renderTargets = targets.empty() ? kNoRenderTargets : render_target_ids.try_emplace(targets, static_cast<uint32_t>(render_target_ids.size())).first->second;
+			}
+			textures.resize(texture_ids.size());
+			buffers.resize(buffer_ids.size());
+		}
+
+		void reset() {
+			std::fill(textures.begin(), textures.end(), TextureState{});
+			std::fill(buffers.begin(), buffers.end(), BufferState{});
+			renderTargets = kNoRenderTargets;
+		}
+		uint32_t cost(uint32_t position) const {
+			const PassAccesses& pass = passes[position];
+			uint32_t total = 0;
+			for (uint32_t i = pass.textureBegin; i < pass.textureEnd; ++i) {
+				const TextureAccess& access = textureAccesses[i];
+				const TextureState& state = textures[access.id];
+				if (state.layout == kUnknownLayout)
+					continue;
+				if (state.layout != access.layout)
+					total += kTransitionCost + kBarrierCost;
+				else if (state.written || access.isWrite)
+					total += kBarrierCost;
+			}
+			for (uint32_t i = pass.bufferBegin; i < pass.bufferEnd; ++i) {
+				const BufferAccess& access = bufferAccesses[i];
+				const BufferState& state = buffers[access.id];
+				if (state.known && (state.written || access.isWrite))
+					total += kBarrierCost;
+			}
+			if (pass.isGraphics && renderTargets != kNoRenderTargets && pass.renderTargets != renderTargets)
+				total += kRenderTargetSwitchCost;
+			return total;
+		}
+		void apply(uint32_t position) {
+			const PassAccesses& pass = passes[position];
+			for (uint32_t i = pass.textureBegin; i < pass.textureEnd; ++i)
+				textures[textureAccesses[i].id] = {textureAccesses[i].layout, textureAccesses[i].isWrite};
+			for (uint32_t i = pass.bufferBegin; i < pass.bufferEnd; ++i)
+				buffers[bufferAccesses[i].id] = {true, bufferAccesses[i].isWrite};
+			if (pass.isGraphics)
+				renderTargets = pass.renderTargets;
+		}
+	};
+
+	// greedy list scheduling over the dag, out of the passes whose predecessors already ran the cheapest one goes next
+	// so independent passes sharing layouts and render targets end up back to back. ties keep the declaration order
+	std::vector<uint32_t> order_passes_for_barriers(const std::vector<uint32_t>& culled_order, const AdjacencyList& predecessors, const std::vector<PassDesc>& pass_descs) {
+		// only the earliest declared ready passes get scored, a wide graph would otherwise rescore all of them every step
+		constexpr uint32_t kMaxScoredPasses = 32;
+		const auto pass_count = static_cast<uint32_t>(culled_order.size());
+		// positions in culled_order double as the tie breaker
+		std::vector<uint32_t> position(predecessors.offsets.size() - 1, UINT32_MAX);
+		for (uint32_t i = 0; i < pass_count; ++i)
+			position[culled_order[i]] = i;
+		std::vector<uint32_t> remaining_preds(pass_count, 0);
+		std::vector<std::vector<uint32_t>> successors(pass_count);
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			for (const uint32_t pred : predecessors[culled_order[i]]) {
+				if (position[pred] == UINT32_MAX)
+					continue;
+				remaining_preds[i]++;
+				successors[position[pred]].push_back(i);
+			}
+		}
+		// min heap on position, the front is the earliest declared ready pass
+		const auto later = [](uint32_t a, uint32_t b) { return a > b; };
+		std::vector<uint32_t> ready;
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			if (remaining_preds[i] == 0)
+				ready.push_back(i);
+		}
+		std::make_heap(ready.begin(), ready.end(), later);
+
+		PassOrderSimulator simulator(culled_order, pass_descs);
+		std::vector<uint32_t> order;
+		order.reserve(pass_count);
+		uint32_t order_cost = 0;
+		std::array<uint32_t, kMaxScoredPasses> candidates{};
+		while (!ready.empty()) {
+			uint32_t candidate_count = 0;
+			while (!ready.empty() && candidate_count < kMaxScoredPasses) {
+				std::pop_heap(ready.begin(), ready.end(), later);
+				candidates[candidate_count++] = ready.back();
+				ready.pop_back();
+			}
+			// candidates come out in declaration order, only a strictly cheaper one replaces the best
+			uint32_t best = 0;
+			uint32_t best_cost = simulator.cost(candidates[0]);
+			for (uint32_t c = 1; c < candidate_count && best_cost != 0; ++c) {
+				const uint32_t cost = simulator.cost(candidates[c]);
+				if (cost < best_cost) {
+					best = c;
+					best_cost = cost;
+				}
+			}
+			for (uint32_t c = 0; c < candidate_count; ++c) {
+				if (c == best)
+					continue;
+				ready.push_back(candidates[c]);
+				std::push_heap(ready.begin(), ready.end(), later);
+			}
+			const uint32_t chosen = candidates[best];
+			order.push_back(culled_order[chosen]);
+			order_cost += best_cost;
+			simulator.apply(chosen);
+			for (const uint32_t successor : successors[chosen]) {
+				if (--remaining_preds[successor] == 0) {
+					ready.push_back(successor);
+					std::push_heap(ready.begin(), ready.end(), later);
+				}
+			}
+		}
+		ASSERT_MSG(order.size() == pass_count, "RenderGraph pass ordering lost passes, the graph must contain a cycle!");
+
+		// declaration order is the one culled_order already has, one more linear walk over the flattened accesses
+		simulator.reset();
+		uint32_t declaration_cost = 0;
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			declaration_cost += simulator.cost(i);
+			simulator.apply(i);
+		}
+		LOG_SYSTEM(LogType::Info, "RenderGraph ordered {} passes (estimated cost {}, declaration order {}).", pass_count, order_cost, declaration_cost);
+		return order;
+	}
+
+	// longest path through the dag weighted by pass cost, a pass with slack can run late without delaying the frame
+	// compute passes with enough slack go to async compute as long as what they take off graphics outweighs
+	// the semaphore waits and ownership transfers every edge to a pass on another queue adds
+	// compiled_passes are in the order of culled_order, which is topological
+	void assign_async_compute(std::vector<CompiledPass>& compiled_passes, const std::vector<uint32_t>& culled_order, const AdjacencyList& predecessors, const std::unordered_map<std::string, float>& pass_costs) {
+		// rough price of one cross queue edge, a timeline wait plus a release/acquire pair
+		constexpr float kCrossQueueSyncMs = 0.05f;
+		constexpr float kDefaultPassMs = 1.f;
+		const auto pass_count = static_cast<uint32_t>(culled_order.size());
+		std::vector<uint32_t> position(predecessors.offsets.size() - 1, UINT32_MAX);
+		for (uint32_t i = 0; i < pass_count; ++i)
+			position[culled_order[i]] = i;
+		std::vector<std::vector<uint32_t>> preds(pass_count), succs(pass_count);
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			for (const uint32_t pred : predecessors[culled_order[i]]) {
+				if (position[pred] != UINT32_MAX) {
+					preds[i].push_back(position[pred]);
+					succs[position[pred]].push_back(i);
+				}
+			}
+		}
+		std::vector<float> cost(pass_count);
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			const auto it = pass_costs.find(compiled_passes[i].name);
+			cost[i] = it != pass_costs.end() ? it->second : kDefaultPassMs;
+		}
+		// earliest finish going forward, latest finish going backward
+		std::vector<float> earliest_finish(pass_count, 0.f);
+		float critical_path = 0.f;
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			float start = 0.f;
+			for (const uint32_t pred : preds[i])
+				start = std::max(start, earliest_finish[pred]);
+			earliest_finish[i] = start + cost[i];
+			critical_path = std::max(critical_path, earliest_finish[i]);
+		}
+		std::vector<float> latest_finish(pass_count, critical_path);
+		for (uint32_t i = pass_count; i-- > 0;) {
+			for (const uint32_t succ : succs[i])
+				latest_finish[i] = std::min(latest_finish[i], latest_finish[succ] - cost[succ]);
+		}
+
+		// biggest passes first, they take the most off graphics
+		std::vector<uint32_t> candidates;
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			const CompiledPass& pass = compiled_passes[i];
+			if (pass.type == PassDesc::Type::Compute && pass.queue == QueueAffinity::Graphics && !pass.usesSwapchain)
+				candidates.push_back(i);
+		}
+		std::sort(candidates.begin(), candidates.end(), [&cost](uint32_t a, uint32_t b) { return cost[a] > cost[b]; });
+		for (const uint32_t i : candidates) {
+			const float slack = latest_finish[i] - earliest_finish[i];
+			uint32_t cross_edges = 0;
+			for (const uint32_t pred : preds[i])
+				cross_edges += compiled_passes[pred].queue != QueueAffinity::AsyncCompute;
+			for (const uint32_t succ : succs[i])
+				cross_edges += compiled_passes[succ].queue != QueueAffinity::AsyncCompute;
+			const float sync_cost = static_cast<float>(cross_edges) * kCrossQueueSyncMs;
+			// on the critical path, or the syncs would eat what it frees up on graphics
+			if (slack <= sync_cost || cost[i] <= sync_cost)
+				continue;
+			compiled_passes[i].queue = QueueAffinity::AsyncCompute;
+			LOG_SYSTEM_NOSOURCE(LogType::Info, "Pass '{}' moved to async compute: {:.3f} ms of slack on a {:.3f} ms critical path.", compiled_passes[i].name, slack, critical_path);
+		}
+	}
+
+	// resources are exclusive to one queue family at a time, so two passes of the same layer
+	// cannot touch the same resource from different queues. graphics always wins, the async pass is demoted
+	void demote_same_layer_queue_conflicts(std::vector<CompiledPass>& compiled_passes, const ExecutionSchedule& schedule, const std::unordered_map<uint32_t, uint32_t>& pass_to_compiled) {
+		std::unordered_map<TextureHandle, uint32_t> texQueues;
+		std::unordered_map<BufferHandle, uint32_t> bufQueues;
+		for (const std::vector<uint32_t>& layer : schedule.layers) {
+			// demoting one pass can create a new conflict for another, so go until nothing changes
+			bool changed = true;
+			while (changed) {
+				changed = false;
+				texQueues.clear();
+				bufQueues.clear();
+				for (const uint32_t pass_idx : layer) {
+					const CompiledPass& pass = compiled_passes[pass_to_compiled.at(pass_idx)];
+					const uint32_t queueBit = 1u << static_cast<uint32_t>(pass.queue);
+					for (const CompiledImageBarrier& barrier : pass.imageBarriers)
+						if (!barrier.isSwapchain) texQueues[barrier.handle] |= queueBit;
+					for (const CompiledBufferBarrier& barrier : pass.bufferBarriers)
+						bufQueues[barrier.handle] |= queueBit;
+				}
+				auto isShared = [](uint32_t queueBits) { return (queueBits & (queueBits - 1)) != 0; };
+				for (const uint32_t pass_idx : layer) {
+					CompiledPass& pass = compiled_passes[pass_to_compiled.at(pass_idx)];
+					if (pass.queue == QueueAffinity::Graphics)
+						continue;
+					const bool conflicts =
+					        std::any_of(pass.imageBarriers.begin(), pass.imageBarriers.end(), [&](const CompiledImageBarrier& b) { return !b.isSwapchain && isShared(texQueues[b.handle]); }) ||
+					        std::any_of(pass.bufferBarriers.begin(), pass.bufferBarriers.end(), [&](const CompiledBufferBarrier& b) { return isShared(bufQueues[b.handle]); });
+					if (!conflicts)
+						continue;
+					LOG_SYSTEM_NOSOURCE(LogType::Info, "Pass '{}' demoted to graphics: Shares a resource with another queue in the same layer.", pass.name);
+					pass.queue = QueueAffinity::Graphics;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// walks the layers in order simulating which queue owns each resource, every owner change becomes
+	// a release/acquire pair at that layers boundary. the cross-queue dag edges become timeline waits.
+	// everything is handed back to graphics at the end so every frame starts from the same ownership
+	std::vector<CrossQueueSync> plan_cross_queue_syncs(
+		const std::vector<CompiledPass>& compiled_passes,
+		const std::vector<std::array<std::vector<uint32_t>, kQueueCount>>& layer_by_queue,
+		const AdjacencyList& predecessors,
+		const std::unordered_map<uint32_t, uint32_t>& pass_to_compiled) {
+
+		const size_t layer_count = layer_by_queue.size();
+		std::vector<CrossQueueSync> result(layer_count + 1);
+
+		std::unordered_map<TextureHandle, QueueAffinity> texOwner;
+		std::unordered_map<BufferHandle, QueueAffinity> bufOwner;
+		// index into the boundary's transfers, lets multiple accesses in one boundary share a single acquire
+		std::unordered_map<TextureHandle, size_t> texTransfer;
+		std::unordered_map<BufferHandle, size_t> bufTransfer;
+
+		for (size_t depth = 0; depth < layer_count; ++depth) {
+			CrossQueueSync& sync = result[depth];
+			texTransfer.clear();
+			bufTransfer.clear();
+			for (size_t q = 0; q < kQueueCount; ++q) {
+				const auto queue = static_cast<QueueAffinity>(q);
+				for (const uint32_t compiled_idx : layer_by_queue[depth][q]) {
+					const CompiledPass& pass = compiled_passes[compiled_idx];
+					for (const uint32_t pred : predecessors[pass.passIndex]) {
+						auto it = pass_to_compiled.find(pred);
+						if (it == pass_to_compiled.end())
+							continue;
+						const QueueAffinity predQueue = compiled_passes[it->second].queue;
+						if (predQueue != queue)
+							sync.waits[q][static_cast<size_t>(predQueue)] = true;
+					}
+					for (const CompiledImageBarrier& barrier : pass.imageBarriers) {
+						if (barrier.isSwapchain)
+							continue;
+						QueueAffinity& owner = texOwner.try_emplace(barrier.handle, QueueAffinity::Graphics).first->second;
+						if (owner == queue) {
+							if (auto it = texTransfer.find(barrier.handle); it != texTransfer.end()) {
+								sync.transfers[it->second].dstMask.stage |= barrier.dstMask.stage;
+								sync.transfers[it->second].dstMask.access |= barrier.dstMask.access;
+							}
+							continue;
+						}
+						texTransfer[barrier.handle] = sync.transfers.size();
+						sync.transfers.push_back({.texture = barrier.handle, .srcQueue = owner, .dstQueue = queue, .dstMask = barrier.dstMask});
+						sync.waits[q][static_cast<size_t>(owner)] = true;
+						owner = queue;
+					}
+					for (const CompiledBufferBarrier& barrier : pass.bufferBarriers) {
+						QueueAffinity& owner = bufOwner.try_emplace(barrier.handle, QueueAffinity::Graphics).first->second;
+						if (owner == queue) {
+							if (auto it = bufTransfer.find(barrier.handle); it != bufTransfer.end()) {
+								sync.transfers[it->second].dstMask.stage |= barrier.dstMask.stage;
+								sync.transfers[it->second].dstMask.access |= barrier.dstMask.access;
+							}
+							continue;
+						}
+						bufTransfer[barrier.handle] = sync.transfers.size();
+						sync.transfers.push_back({.buffer = barrier.handle, .srcQueue = owner, .dstQueue = queue, .dstMask = barrier.dstMask});
+						sync.waits[q][static_cast<size_t>(owner)] = true;
+						owner = queue;
+					}
+				}
+			}
+		}
+
+		// end of frame, graphics takes everything back and waits on all async work so the frame timeline covers it
+		CrossQueueSync& end_sync = result[layer_count];
+		constexpr vkutil::StageAccess kFrameEndMask = {.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
+		constexpr auto graphics = static_cast<size_t>(QueueAffinity::Graphics);
+		for (const auto& [handle, owner] : texOwner) {
+			if (owner != QueueAffinity::Graphics)
+				end_sync.transfers.push_back({.texture = handle, .srcQueue = owner, .dstQueue = QueueAffinity::Graphics, .dstMask = kFrameEndMask});
+		}
+		for (const auto& [handle, owner] : bufOwner) {
+			if (owner != QueueAffinity::Graphics)
+				end_sync.transfers.push_back({.buffer = handle, .srcQueue = owner, .dstQueue = QueueAffinity::Graphics, .dstMask = kFrameEndMask});
+		}
+		for (const CompiledPass& pass : compiled_passes) {
+			if (pass.queue != QueueAffinity::Graphics)
+				end_sync.waits[graphics][static_cast<size_t>(pass.queue)] = true;
+		}
+
+		// anyone being waited on has to submit at that boundary
+		for (CrossQueueSync& sync : result) {
+			for (size_t c = 0; c < kQueueCount; ++c)
+				for (size_t p = 0; p < kQueueCount; ++p)
+					if (sync.waits[c][p]) sync.signals[p] = true;
 		}
 		return result;
 	}
@@ -729,7 +1660,7 @@ namespace mythril {
 	// purely for development purposes
 	static void DumpRenderGraphDot(
 		const std::vector<CompiledPass>& compiledPasses,
-		const std::vector<std::unordered_set<uint32_t>>& predecessors,
+		const AdjacencyList& predecessors,
 		const ExecutionSchedule& schedule
 	) {
 		const char* path = std::getenv("MYTHRIL_DUMP_RG");
@@ -883,31 +1814,249 @@ namespace mythril {
 		LOG_SYSTEM(LogType::Info, "RenderGraph flame SVG written to '{}'.", flamePath);
 	}
 
-	void RenderGraph::compile(CTX& rCtx) {
+	// descs hold references, so pointing them at another texture means rebuilding them
+	static void RetargetTextureDescs(PassDesc& desc, const Texture& from, Texture& to) {
+		const auto retarget = [&from, &to](const TextureDesc& texDesc) {
+			TextureDesc result(&texDesc.texture == &from ? to : texDesc.texture);
+			result.baseLevel = texDesc.baseLevel;
+			result.numLevels = texDesc.numLevels;
+			result.baseLayer = texDesc.baseLayer;
+			result.numLayers = texDesc.numLayers;
+			result.type = texDesc.type;
+			return result;
+		};
+		std::vector<TextureDependencyDesc> dependencies;
+		dependencies.reserve(desc.textureDependencyOperations.size());
+		for (const TextureDependencyDesc& dependency_desc : desc.textureDependencyOperations)
+			dependencies.push_back({retarget(dependency_desc.texDesc), dependency_desc.desiredLayout});
+		desc.textureDependencyOperations = std::move(dependencies);
+
+		std::vector<AttachmentDesc> attachments;
+		attachments.reserve(desc.attachmentOperations.size());
+		for (const AttachmentDesc& attachment_desc : desc.attachmentOperations) {
+			AttachmentDesc& attachment = attachments.emplace_back(AttachmentDesc{retarget(attachment_desc.texDesc), attachment_desc.clearValue, attachment_desc.loadOp, attachment_desc.storeOp});
+			if (attachment_desc.resolveTexDesc.has_value())
+				attachment.resolveTexDesc.emplace(retarget(attachment_desc.resolveTexDesc.value()));
+		}
+		desc.attachmentOperations = std::move(attachments);
+	}
+
+	// puts the descs back the way the user declared them, every compile picks its renames from scratch
+	void RenderGraph::restoreTextureVersions() {
+		for (TransientTexture& transient : _transientTextures) {
+			if (transient.versionFirstPass == UINT32_MAX)
+				continue;
+			const Texture& version = _transientTextures[transient.versionIdx].texture;
+			for (uint32_t i = transient.versionFirstPass; i < static_cast<uint32_t>(_passDescriptions.size()); ++i)
+				RetargetTextureDescs(_passDescriptions[i], version, transient.texture);
+			transient.versionFirstPass = UINT32_MAX;
+		}
+	}
+
+	// a pass that completely overwrites a transient after something read it only waits on those reads (WAR)
+	// if that wait is on the critical path, the overwrite and everything after it move to a second version
+	// renames are tried one transient at a time and kept only if the graph gets fewer layers, like ping-ponging by hand
+	void RenderGraph::selectTextureVersions(CTX& rCtx) {
+		_versioningBytes = 0;
+		_versioningLayersSaved = 0;
+		if (!_textureVersioning || _transientTextures.empty())
+			return;
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
-		this->_compiledPasses.clear();
-		this->_resourceTrackers.clear();
-		this->_bufferTrackers.clear();
+		const auto pass_count = static_cast<uint32_t>(_passDescriptions.size());
+
+		// every transient that could be renamed, gathered in one walk over the passes
+		struct VersionScan {
+			uint32_t transient;
+			SubresourceRange wholeRange;
+			// passes touching it in declaration order, the only ones whose edges a rename can drop
+			std::vector<uint32_t> passes;
+			std::vector<uint32_t> candidates;
+			bool readSinceWrite = false;
+			bool usedInParallel = false;
+			// what the pass being visited does with it
+			bool reads = false;
+			bool writes = false;
+			bool overwrites = false;
+			uint32_t visitedPass = UINT32_MAX;
+		};
+		std::vector<VersionScan> scans;
+		std::unordered_map<TextureHandle, uint32_t> scanIds;
+		for (uint32_t t = 0; t < static_cast<uint32_t>(_transientTextures.size()); ++t) {
+			const TransientTexture& transient = _transientTextures[t];
+			const TextureHandle handle = transient.texture.handle();
+			// outputs are read after the graph ran through the texture the user knows
+			if (transient.versionOf != UINT32_MAX || std::find(_outputTextures.begin(), _outputTextures.end(), handle) != _outputTextures.end())
+				continue;
+			const AllocatedTexture& texture = transient.texture.view();
+			scanIds[handle] = static_cast<uint32_t>(scans.size());
+			scans.push_back({.transient = t, .wholeRange = {0, texture.getNumMips(), 0, texture.getNumLayers()}});
+		}
+		std::vector<uint32_t> touched;
+		for (uint32_t i = 0; i < pass_count; ++i) {
+			const PassDesc& desc = _passDescriptions[i];
+			touched.clear();
+			const auto visit = [&](const TextureDesc& texDesc, bool isRead, bool isWrite) {
+				const auto it = scanIds.find(texDesc.texture.handle());
+				if (it == scanIds.end())
+					return;
+				VersionScan& scan = scans[it->second];
+				if (scan.visitedPass != i) {
+					scan.visitedPass = i;
+					touched.push_back(it->second);
+				}
+				scan.reads |= isRead;
+				scan.writes |= isWrite;
+				if (isWrite && !isRead)
+					scan.overwrites |= ResolveSubresourceRange(texDesc, texDesc.texture.view(), desc.name).contains(scan.wholeRange);
+			};
+			for (const TextureDependencyDesc& dependency_desc : desc.textureDependencyOperations)
+				visit(dependency_desc.texDesc, dependency_desc.desiredLayout != Layout::TRANSFER_DST, isWrite(dependency_desc.desiredLayout));
+			for (const AttachmentDesc& attachment_desc : desc.attachmentOperations) {
+				visit(attachment_desc.texDesc, attachment_desc.loadOp == LoadOp::LOAD, true);
+				if (attachment_desc.resolveTexDesc.has_value())
+					visit(attachment_desc.resolveTexDesc.value(), false, true);
+			}
+			for (const uint32_t scanIdx : touched) {
+				VersionScan& scan = scans[scanIdx];
+				if (scan.reads || scan.writes) {
+					scan.passes.push_back(i);
+					// chunks record on worker threads, the Texture cant be swapped under them
+					scan.usedInParallel |= desc.chunkCount > 0;
+					if (scan.readSinceWrite && scan.overwrites && !scan.reads)
+						scan.candidates.push_back(i);
+					scan.readSinceWrite = scan.reads || (scan.readSinceWrite && !scan.writes);
+				}
+				scan.reads = scan.writes = scan.overwrites = false;
+			}
+		}
 
-		const DirectedGraph directed_graph = build_directed_graph(this->_passDescriptions);
+		// the dag with the renames kept so far, plus the longest path in layers into (depths) and out of (heights) every pass
+		// renaming at a pass only drops edges into it from earlier passes on the same transient, so it can only
+		// shorten the graph when one of those edges is on the critical path. only those candidates get a full rebuild
+		std::unordered_map<TextureHandle, uint32_t> renamedFrom;
+		AdjacencyList predecessors;
+		std::vector<uint32_t> depths;
+		std::vector<uint32_t> heights;
+		const auto analyze = [&]() -> uint32_t {
+			DirectedGraph graph = build_directed_graph(_passDescriptions, renamedFrom);
+			const std::optional<std::vector<uint32_t>> sorted_order = graph.topologicalSort();
+			// compile reports the cycle
+			if (!sorted_order)
+				return UINT32_MAX;
+			depths.assign(pass_count, 0);
+			heights.assign(pass_count, 0);
+			uint32_t max_depth = 0;
+			for (const uint32_t pass_idx : sorted_order.value()) {
+				for (const uint32_t pred : graph.predecessors[pass_idx])
+					depths[pass_idx] = std::max(depths[pass_idx], depths[pred] + 1);
+				max_depth = std::max(max_depth, depths[pass_idx]);
+			}
+			for (auto it = sorted_order->rbegin(); it != sorted_order->rend(); ++it) {
+				for (const uint32_t succ : graph.successors[*it])
+					heights[*it] = std::max(heights[*it], heights[succ] + 1);
+			}
+			predecessors = std::move(graph.predecessors);
+			return max_depth + 1;
+		};
+		const uint32_t baseLayers = analyze();
+		if (baseLayers == UINT32_MAX)
+			return;
+		uint32_t currentLayers = baseLayers;
+		std::vector<uint32_t> renamedTransients;
+		for (const VersionScan& scan : scans) {
+			if (scan.usedInParallel || scan.candidates.empty())
+				continue;
+			const TextureHandle handle = _transientTextures[scan.transient].texture.handle();
+			uint32_t bestPass = UINT32_MAX;
+			uint32_t bestLayers = currentLayers;
+			for (const uint32_t candidate : scan.candidates) {
+				bool isCritical = false;
+				for (const uint32_t pred : predecessors[candidate]) {
+					if (depths[pred] + heights[candidate] + 2 == currentLayers && std::binary_search(scan.passes.begin(), scan.passes.end(), pred)) {
+						isCritical = true;
+						break;
+					}
+				}
+				if (!isCritical)
+					continue;
+				renamedFrom[handle] = candidate;
+				const uint32_t layers = count_schedule_layers(_passDescriptions, renamedFrom);
+				if (layers < bestLayers) {
+					bestLayers = layers;
+					bestPass = candidate;
+				}
+			}
+			renamedFrom.erase(handle);
+			if (bestPass == UINT32_MAX)
+				continue;
+			renamedFrom[handle] = bestPass;
+			currentLayers = bestLayers;
+			renamedTransients.push_back(scan.transient);
+			// the critical path moved, the next transient is judged against the graph with this rename
+			analyze();
+		}
 
-		// yeah i know this is doing more work then necessary but its way better to understand
-		const std::vector<std::unordered_set<uint32_t>>& passPredecessors = directed_graph.predecessors;
-		const std::optional<std::vector<uint32_t>>& sorted_order_opt = directed_graph.topologicalSort();
-		if (!sorted_order_opt) {
-			// who cares about the recalculation overhead
-			report_cycle_and_assert(directed_graph, this->_passDescriptions);
+		for (const uint32_t t : renamedTransients) {
+			// deque, so neither reference moves when the version is added
+			TransientTexture& transient = _transientTextures[t];
+			if (transient.versionIdx == UINT32_MAX) {
+				transient.versionIdx = static_cast<uint32_t>(_transientTextures.size());
+				TransientTexture& version = _transientTextures.emplace_back();
+				version.name = transient.name + " (Version 1)";
+				version.spec = transient.spec;
+				version.spec.debugName = version.name.c_str();
+				version.versionOf = t;
+				version.texture = Texture{&rCtx, rCtx.createTextureFromSpecImpl(version.spec, true)};
+			}
+			Texture& version = _transientTextures[transient.versionIdx].texture;
+			const Dimensions dimensions = rCtx.view(transient.texture.handle()).getDimensions();
+			if (rCtx.view(version.handle()).getDimensions() != dimensions)
+				version.resize(dimensions);
+
+			transient.versionFirstPass = renamedFrom[transient.texture.handle()];
+			for (uint32_t i = transient.versionFirstPass; i < static_cast<uint32_t>(_passDescriptions.size()); ++i)
+				RetargetTextureDescs(_passDescriptions[i], transient.texture, version);
+
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(rCtx._vkDevice, rCtx.view(version.handle()).getImage(), &requirements);
+			_versioningBytes += requirements.size;
 		}
-		const std::vector<uint32_t>& culled_order = cull_unused_passes(sorted_order_opt.value(), passPredecessors, _passDescriptions);
+		_versioningLayersSaved = baseLayers - currentLayers;
+		if (!renamedTransients.empty()) {
+			LOG_SYSTEM(
+			        LogType::Info,
+			        "RenderGraph versioned {} transient textures, {} -> {} layers for {:.2f} MB of transient memory before aliasing.",
+			        renamedTransients.size(),
+			        baseLayers,
+			        currentLayers,
+			        static_cast<double>(_versioningBytes) / (1024.0 * 1024.0)
+			);
+		}
+	}
 
-		const ExecutionSchedule schedule = calculate_execution_schedule(culled_order, passPredecessors);
-		this->_schedule = schedule;
+	// callbacks only know the Texture& they captured, it points at the version their pass was compiled against while they run
+	void RenderGraph::swapTextureVersions(const CompiledPass& pass) {
+		for (const uint32_t idx : pass.versionedTransients) {
+			TransientTexture& transient = _transientTextures[idx];
+			Texture& version = _transientTextures[transient.versionIdx].texture;
+			std::swap(transient.texture._handle, version._handle);
+			std::swap(transient.texture._additionalViews, version._additionalViews);
+		}
+	}
 
+	// which queue every pass runs on, plus the per-layer split and cross queue syncs that follow from it
+	// expects the barriers of every pass as processPassResources left them, async passes get theirs masked here
+	void RenderGraph::planQueues(CTX& rCtx, const AdjacencyList& passPredecessors) {
 		// map from passDescription to _compiledPasses, reversed basically
+		std::vector<uint32_t> culled_order;
+		culled_order.reserve(_compiledPasses.size());
 		std::unordered_map<uint32_t, uint32_t> passToCompiled;
-		passToCompiled.reserve(culled_order.size());
-		for (uint32_t i = 0; i < static_cast<uint32_t>(culled_order.size()); ++i)
-			passToCompiled[culled_order[i]] = i;
+		passToCompiled.reserve(_compiledPasses.size());
+		for (const CompiledPass& compiled_pass : this->_compiledPasses) {
+			passToCompiled[compiled_pass.passIndex] = static_cast<uint32_t>(culled_order.size());
+			culled_order.push_back(compiled_pass.passIndex);
+		}
+		const ExecutionSchedule& schedule = this->_schedule;
 
 		// assign and warn queues for each pass
 		const bool canUseAC = rCtx._immAsyncCompute != nullptr;
@@ -916,7 +2065,7 @@ namespace mythril {
 			// demote passes that request a queue but we dont have access to
 			if (requested_queue == QueueAffinity::AsyncCompute && !canUseAC) {
 				LOG_SYSTEM_NOSOURCE(LogType::Warning, "Pass '{}' demoted to graphics: No async compute family available.", pass_name);
-				return QueueAffinity::AsyncTransfer;
+				return QueueAffinity::Graphics;
 			}
 			if (requested_queue == QueueAffinity::AsyncTransfer && !canUseAT) {
 				if (canUseAC) {
@@ -929,6 +2078,76 @@ namespace mythril {
 			return requested_queue;
 		};
 
+		for (CompiledPass& compiled_pass : this->_compiledPasses) {
+			compiled_pass.queue = sanitizeQueue(this->_passDescriptions[compiled_pass.passIndex].queue, compiled_pass.name);
+			if (compiled_pass.usesSwapchain && compiled_pass.queue != QueueAffinity::Graphics) {
+				LOG_SYSTEM_NOSOURCE(LogType::Info, "Pass '{}' demoted to graphics: Swapchain images are graphics only.", compiled_pass.name);
+				compiled_pass.queue = QueueAffinity::Graphics;
+			}
+		}
+		if (_autoAsyncCompute && canUseAC) {
+			// timings of the previous compile are keyed by name, compiled indices may have shifted since
+			std::unordered_map<std::string, float> pass_costs;
+			for (const PassTiming& timing : this->_passTimings) {
+				if (timing.numSamples > 0)
+					pass_costs[timing.name] = timing.avgMs;
+			}
+			assign_async_compute(this->_compiledPasses, culled_order, passPredecessors, pass_costs);
+		}
+		demote_same_layer_queue_conflicts(this->_compiledPasses, schedule, passToCompiled);
+
+		// queues are final now, barriers recorded on an async queue can only name stages it supports
+		this->_hasAsyncWork = false;
+		for (CompiledPass& pass : this->_compiledPasses) {
+			if (pass.queue == QueueAffinity::Graphics)
+				continue;
+			this->_hasAsyncWork = true;
+			for (CompiledImageBarrier& barrier : pass.imageBarriers)
+				barrier.dstMask = MaskStageAccessForQueue(barrier.dstMask, pass.queue);
+			for (CompiledBufferBarrier& barrier : pass.bufferBarriers)
+				barrier.dstMask = MaskStageAccessForQueue(barrier.dstMask, pass.queue);
+		}
+
+		// build _layerByQueue from post cleaned _compiledPassses
+		// requires that correct queues have already been selected
+		this->_layerByQueue.assign(schedule.layers.size(), {});
+		for (size_t depth = 0; depth < schedule.layers.size(); ++depth) {
+			for (const uint32_t pass_idx : schedule.layers[depth]) {
+				const uint32_t compiled_idx = passToCompiled[pass_idx];
+				const auto q = static_cast<size_t>(_compiledPasses[compiled_idx].queue);
+				this->_layerByQueue[depth][q].push_back(compiled_idx);
+			}
+		}
+		this->_layerSyncs = plan_cross_queue_syncs(this->_compiledPasses, this->_layerByQueue, passPredecessors, passToCompiled);
+		for (auto& acquires : this->_pendingImageAcquires) acquires.clear();
+		for (auto& acquires : this->_pendingBufferAcquires) acquires.clear();
+	}
+
+	void RenderGraph::compile(CTX& rCtx) {
+		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
+		this->_compiledPasses.clear();
+		this->_resourceTrackers.clear();
+		this->_bufferTrackers.clear();
+
+		restoreTextureVersions();
+		selectTextureVersions(rCtx);
+		const DirectedGraph directed_graph = build_directed_graph(this->_passDescriptions);
+
+		// yeah i know this is doing more work then necessary but its way better to understand
+		const std::optional<std::vector<uint32_t>>& sorted_order_opt = directed_graph.topologicalSort();
+		if (!sorted_order_opt) {
+			// who cares about the recalculation overhead
+			report_cycle_and_assert(directed_graph, this->_passDescriptions);
+		}
+		// everything past here only cares about what runs before what, so the edges other paths imply are dropped
+		// fewer edges to walk for culling and scheduling, and no cross queue waits that another wait already covers
+		const AdjacencyList passPredecessors = reduce_transitive_edges(directed_graph.predecessors, sorted_order_opt.value());
+		const std::vector<uint32_t> culled_order = order_passes_for_barriers(
+		        cull_unused_passes(sorted_order_opt.value(), passPredecessors, _passDescriptions, _outputTextures, _outputBuffers), passPredecessors, _passDescriptions);
+
+		const ExecutionSchedule schedule = calculate_execution_schedule(culled_order, passPredecessors);
+		this->_schedule = schedule;
+
 		// compile works in this order
 		this->_compiledPasses.reserve(culled_order.size());
 		for (const uint32_t pass_idx : culled_order) {
@@ -936,32 +2155,45 @@ namespace mythril {
 			CompiledPass compiled_pass;
 			compiled_pass.name = pass_desc.name;
 			compiled_pass.passIndex = pass_idx;
-			compiled_pass.queue = sanitizeQueue(pass_desc.queue, pass_desc.name);
 			compiled_pass.type = pass_desc.type;
 			compiled_pass.executeCallback = pass_desc.executeCallback;
+			compiled_pass.parallelCallback = pass_desc.parallelCallback;
+			compiled_pass.chunkCount = pass_desc.chunkCount;
+			compiled_pass.isStatic = pass_desc.isStatic;
 			compiled_pass.layerCount = pass_desc.layerCount;
 			compiled_pass.viewMask = pass_desc.viewMask;
 			compiled_pass.conditionCallback = pass_desc.conditionCallback;
-
-			// do not worry about the return value,
-			// every type of process should run for every pass
-			processPassResources(pass_desc, compiled_pass);
-			processAttachments(rCtx, pass_desc, compiled_pass);
+			for (uint32_t i = 0; i < static_cast<uint32_t>(_transientTextures.size()); ++i) {
+				if (pass_idx >= _transientTextures[i].versionFirstPass)
+					compiled_pass.versionedTransients.push_back(i);
+			}
 
 			this->_compiledPasses.push_back(std::move(compiled_pass));
 		}
-
-
-		// build _layerByQueue from post cleaned _compiledPassses
-		// requires that correct queues have already been selected
-		this->_layerByQueue.assign(schedule.layers.size(), {});
-		for (size_t depth = 0; depth < schedule.layers.size(); ++depth) {
-			for (const uint32_t pass_idx : schedule.layers[depth]) {
-				const uint32_t compiled_idx = passToCompiled[pass_idx];
-				const auto q = static_cast<size_t>(_compiledPasses[compiled_idx].queue);
-				this->_layerByQueue[depth][q].push_back(compiled_idx);
-			}
-		}
+		// passes only read their own desc from here on, each worker fills in the passes it picks up
+		// attachments are processed once transient memory is bound, they need image views
+		WorkerPool& workers = rCtx.getWorkerPoolImpl();
+		workers.dispatch(static_cast<uint32_t>(_compiledPasses.size()), [this](uint32_t compiled_idx, uint32_t) {
+			CompiledPass& compiled_pass = this->_compiledPasses[compiled_idx];
+			processPassResources(this->_passDescriptions[compiled_pass.passIndex], compiled_pass);
+			compiled_pass.usesSwapchain = std::any_of(compiled_pass.imageBarriers.begin(), compiled_pass.imageBarriers.end(), [](const CompiledImageBarrier& b) { return b.isSwapchain; });
+		});
+		planQueues(rCtx, passPredecessors);
+
+		allocateTransientMemory(rCtx);
+		// views go through the CTX pools which only this thread may touch, after this the workers only look them up
+		for (const CompiledPass& compiled_pass : this->_compiledPasses)
+			CreateAttachmentViews(this->_passDescriptions[compiled_pass.passIndex]);
+		workers.dispatch(static_cast<uint32_t>(_compiledPasses.size()), [this, &rCtx](uint32_t compiled_idx, uint32_t) {
+			CompiledPass& compiled_pass = this->_compiledPasses[compiled_idx];
+			processAttachments(rCtx, this->_passDescriptions[compiled_pass.passIndex], compiled_pass);
+		});
+		inferAttachmentOps();
+		bakeBarrierBatches(rCtx);
+		createTimestampPool(rCtx);
+		this->_hasParallelPasses = std::any_of(_compiledPasses.begin(), _compiledPasses.end(), [](const CompiledPass& pass) { return pass.chunkCount > 0; });
+		this->_parallelSecondaries.clear();
+		invalidateStaticPasses();
 		performDryRun(rCtx);
 		this->_hasCompiled = true;
 		this->_compiledEpoch = rCtx._resourceEpoch;
@@ -970,6 +2202,260 @@ namespace mythril {
 #endif
 	}
 
+	// resizes and swapchain recreation only swap out images, the schedule, barrier requests and pipelines stay valid
+	// so only the passes whose attachments were replaced get their attachment infos, views and render areas redone
+	bool RenderGraph::refreshResources(CTX& rCtx) {
+		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
+		// second versions have to follow a resize of the texture they stand in for
+		for (const TransientTexture& transient: _transientTextures) {
+			if (transient.versionFirstPass != UINT32_MAX && rCtx.view(transient.texture.handle()).getDimensions() != rCtx.view(_transientTextures[transient.versionIdx].texture.handle()).getDimensions())
+				return false;
+		}
+		// a resize shifts what every pass costs, so automatic queue assignment gets another look with the latest timings
+		// the dag and schedule dont change, only the queues and what follows from them are planned again
+		bool hasNewQueues = false;
+		if (_autoAsyncCompute && !_passTimings.empty()) {
+			std::vector<QueueAffinity> previousQueues;
+			previousQueues.reserve(_compiledPasses.size());
+			for (CompiledPass& pass: _compiledPasses) {
+				previousQueues.push_back(pass.queue);
+				// the masks were narrowed to the queue the pass was on, start over from what its desc asks for
+				if (pass.queue == QueueAffinity::Graphics)
+					continue;
+				pass.imageBarriers.clear();
+				pass.bufferBarriers.clear();
+				processPassResources(_passDescriptions[pass.passIndex], pass);
+			}
+			// same graph the compile planned with, it was acyclic then and the descs havent changed
+			const DirectedGraph directed_graph = build_directed_graph(_passDescriptions);
+			planQueues(rCtx, reduce_transitive_edges(directed_graph.predecessors, directed_graph.topologicalSort().value()));
+			for (size_t i = 0; i < _compiledPasses.size(); ++i) {
+				hasNewQueues |= _compiledPasses[i].queue != previousQueues[i];
+				// timings keep accumulating, only the queue they are reported on moves
+				if (i < _passTimings.size())
+					_passTimings[i].queue = _compiledPasses[i].queue;
+			}
+		}
+		// a resized transient is unbound until its memory is packed again, versions no compile uses never get any
+		const bool hasResetTransients = std::any_of(_transientTextures.begin(), _transientTextures.end(), [this, &rCtx](const TransientTexture& transient) {
+			if (transient.versionOf != UINT32_MAX && _transientTextures[transient.versionOf].versionFirstPass == UINT32_MAX)
+				return false;
+			return rCtx.view(transient.texture.handle()).getImageView() == VK_NULL_HANDLE;
+		});
+		// transients touched by an async queue dont alias, so a queue change repacks all of them
+		if (hasResetTransients || (hasNewQueues && !_transientTextures.empty()))
+			allocateTransientMemory(rCtx);
+
+		const VkImage swapchainIdentity = rCtx.isHeadless() ? VK_NULL_HANDLE : rCtx.view(rCtx._swapchain->getSwapchainTextureHandle(0)).getImage();
+		uint32_t numRefreshed = 0;
+		for (CompiledPass& pass: _compiledPasses) {
+			const PassDesc& pass_desc = _passDescriptions[pass.passIndex];
+			if (!AreAttachmentsStale(pass_desc, pass, swapchainIdentity))
+				continue;
+			// formats are baked into the pipelines, changing them needs the dry run of a full compile
+			std::vector<VkFormat> previousFormats;
+			previousFormats.reserve(pass.colorAttachments.size() + 1);
+			for (const AttachmentInfo& color: pass.colorAttachments)
+				previousFormats.push_back(color.imageFormat);
+			previousFormats.push_back(pass.depthAttachment ? pass.depthAttachment->imageFormat : VK_FORMAT_UNDEFINED);
+
+			processAttachments(rCtx, pass_desc, pass);
+			numRefreshed++;
+
+			if (previousFormats.size() != pass.colorAttachments.size() + 1)
+				return false;
+			for (size_t i = 0; i < pass.colorAttachments.size(); ++i) {
+				if (previousFormats[i] != pass.colorAttachments[i].imageFormat)
+					return false;
+			}
+			if (previousFormats.back() != (pass.depthAttachment ? pass.depthAttachment->imageFormat : VK_FORMAT_UNDEFINED))
+				return false;
+		}
+		// processAttachments put back the ops set by hand
+		if (numRefreshed > 0)
+			inferAttachmentOps();
+		// swapchain barriers are resolved to the current image at execute, but the handle they were compiled with may be gone
+		if (!rCtx.isHeadless()) {
+			const TextureHandle swapchainHandle = rCtx.getCurrentSwapchainTexHandle();
+			for (CompiledPass& pass: _compiledPasses) {
+				for (CompiledImageBarrier& barrier: pass.imageBarriers) {
+					if (barrier.isSwapchain)
+						barrier.handle = swapchainHandle;
+				}
+			}
+		}
+		// recreated images start out undefined, anything the trackers knew about them (or destroyed ones) is stale
+		std::erase_if(_resourceTrackers, [&rCtx](const auto& entry) {
+			const AllocatedTexture* texture = rCtx._texturePool.get(entry.first);
+			return !texture || texture->getImageLayout() == VK_IMAGE_LAYOUT_UNDEFINED;
+		});
+		// the baked batches hold raw VkImages
+		bakeBarrierBatches(rCtx);
+		// render areas may have changed and those are baked into the static secondaries
+		invalidateStaticPasses();
+
+		LOG_SYSTEM(LogType::Info, "Refreshed {} of {} RenderGraph passes after a resource change.", numRefreshed, _compiledPasses.size());
+		this->_compiledEpoch = rCtx._resourceEpoch;
+		return true;
+	}
+
+	// lifetimes are positions in the order execute records passes, transients only share memory when their
+	// lifetimes are disjoint. anything touched by an async queue gets memory of its own, nothing orders
+	// the queues tightly enough to reuse memory across them
+	void RenderGraph::allocateTransientMemory(CTX& rCtx) {
+		for (VmaAllocation allocation: _transientAllocations) {
+			rCtx.deferTask(std::packaged_task<void()>([vma = rCtx._vmaAllocator, allocation]() { vmaFreeMemory(vma, allocation); }));
+		}
+		_transientAllocations.clear();
+		if (_transientTextures.empty())
+			return;
+
+		// position of every compiled pass in recording order, see execute()
+		std::vector<uint32_t> position(_compiledPasses.size());
+		if (_hasAsyncWork) {
+			uint32_t next = 0;
+			for (const auto& layer: _layerByQueue)
+				for (const auto& queuePasses: layer)
+					for (const uint32_t compiled_idx: queuePasses)
+						position[compiled_idx] = next++;
+		} else {
+			for (uint32_t i = 0; i < static_cast<uint32_t>(position.size()); ++i)
+				position[i] = i;
+		}
+
+		struct Lifetime {
+			uint32_t first = UINT32_MAX;
+			uint32_t last = 0;
+			StageAccess lastMask{};
+			bool async = false;
+			VkMemoryRequirements requirements{};
+		};
+		std::vector<Lifetime> lifetimes(_transientTextures.size());
+		std::unordered_map<TextureHandle, uint32_t> transientIndex;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(_transientTextures.size()); ++i)
+			transientIndex[_transientTextures[i].texture.handle()] = i;
+
+		for (uint32_t compiled_idx = 0; compiled_idx < static_cast<uint32_t>(_compiledPasses.size()); ++compiled_idx) {
+			const CompiledPass& pass = _compiledPasses[compiled_idx];
+			for (const CompiledImageBarrier& barrier: pass.imageBarriers) {
+				auto it = transientIndex.find(barrier.handle);
+				if (it == transientIndex.end())
+					continue;
+				Lifetime& lifetime = lifetimes[it->second];
+				const uint32_t pos = position[compiled_idx];
+				const bool seen = lifetime.first != UINT32_MAX;
+				lifetime.first = std::min(lifetime.first, pos);
+				if (!seen || pos > lifetime.last) {
+					lifetime.last = pos;
+					lifetime.lastMask = barrier.dstMask;
+				} else if (pos == lifetime.last) {
+					lifetime.lastMask.stage |= barrier.dstMask.stage;
+					lifetime.lastMask.access |= barrier.dstMask.access;
+				}
+				lifetime.async |= pass.queue != QueueAffinity::Graphics;
+			}
+		}
+
+		// a bound image cant be rebound, so everything from the last compile starts over with a fresh image
+		for (uint32_t i = 0; i < static_cast<uint32_t>(_transientTextures.size()); ++i) {
+			Texture& texture = _transientTextures[i].texture;
+			for (const auto& view: texture._additionalViews)
+				rCtx.destroy(view.second);
+			texture._additionalViews.clear();
+			if (rCtx.view(texture.handle()).getImageView() != VK_NULL_HANDLE)
+				rCtx.resetTransientTextureImpl(texture.handle());
+			vkGetImageMemoryRequirements(rCtx._vkDevice, rCtx.view(texture.handle()).getImage(), &lifetimes[i].requirements);
+			_transientTextures[i].aliasMask = {};
+		}
+
+		// first fit, largest first. every member of a block sits at offset 0 so a block is as big as its largest member
+		struct Block {
+			VkMemoryRequirements requirements;
+			std::vector<uint32_t> members;
+			bool canAlias;
+		};
+		std::vector<uint32_t> order;
+		order.reserve(lifetimes.size());
+		for (uint32_t i = 0; i < static_cast<uint32_t>(lifetimes.size()); ++i) {
+			// culled transients are never touched, they stay without memory
+			if (lifetimes[i].first != UINT32_MAX)
+				order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return lifetimes[a].requirements.size > lifetimes[b].requirements.size; });
+
+		std::vector<Block> blocks;
+		VkDeviceSize requestedBytes = 0;
+		for (const uint32_t i: order) {
+			const Lifetime& lifetime = lifetimes[i];
+			requestedBytes += lifetime.requirements.size;
+			Block* fit = nullptr;
+			if (!lifetime.async) {
+				for (Block& block: blocks) {
+					if (!block.canAlias || !(block.requirements.memoryTypeBits & lifetime.requirements.memoryTypeBits))
+						continue;
+					const bool overlaps = std::any_of(block.members.begin(), block.members.end(), [&](uint32_t other) {
+						return lifetimes[other].first <= lifetime.last && lifetime.first <= lifetimes[other].last;
+					});
+					if (!overlaps) {
+						fit = &block;
+						break;
+					}
+				}
+			}
+			if (!fit) {
+				fit = &blocks.emplace_back(Block{.requirements = lifetime.requirements, .canAlias = !lifetime.async});
+			} else {
+				fit->requirements.size = std::max(fit->requirements.size, lifetime.requirements.size);
+				fit->requirements.alignment = std::max(fit->requirements.alignment, lifetime.requirements.alignment);
+				fit->requirements.memoryTypeBits &= lifetime.requirements.memoryTypeBits;
+			}
+			fit->members.push_back(i);
+		}
+
+		VkDeviceSize allocatedBytes = 0;
+		_transientAllocations.reserve(blocks.size());
+		for (const Block& block: blocks) {
+			const VmaAllocationCreateInfo allocation_ci = {.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			VK_CHECK(vmaAllocateMemory(rCtx._vmaAllocator, &block.requirements, &allocation_ci, &allocation, nullptr));
+			vmaSetAllocationName(rCtx._vmaAllocator, allocation, "RenderGraph Transient Memory");
+			_transientAllocations.push_back(allocation);
+			allocatedBytes += block.requirements.size;
+
+			StageAccess aliasMask{};
+			for (const uint32_t member: block.members) {
+				aliasMask.stage |= lifetimes[member].lastMask.stage;
+				aliasMask.access |= lifetimes[member].lastMask.access;
+			}
+			for (const uint32_t member: block.members) {
+				rCtx.bindTransientTextureImpl(_transientTextures[member].texture.handle(), allocation);
+				_transientTextures[member].aliasMask = aliasMask;
+			}
+		}
+		LOG_SYSTEM(
+		        LogType::Info,
+		        "RenderGraph transient textures: {} requested {:.2f} MB, aliased into {} allocations of {:.2f} MB.",
+		        order.size(),
+		        static_cast<double>(requestedBytes) / (1024.0 * 1024.0),
+		        blocks.size(),
+		        static_cast<double>(allocatedBytes) / (1024.0 * 1024.0)
+		);
+	}
+
+	// transient contents dont survive a frame, and their memory may have been used by an alias since the last use
+	// starting from undefined with the alias' last accesses makes the first barrier of the frame cover both
+	void RenderGraph::resetTransientStates(CTX& rCtx) {
+		for (const TransientTexture& transient: _transientTextures) {
+			const TextureHandle handle = transient.texture.handle();
+			AllocatedTexture& texture = rCtx.access(handle);
+			if (texture.getImageView() == VK_NULL_HANDLE)
+				continue;
+			auto [it, inserted] = _resourceTrackers.try_emplace(handle, texture.getNumMips(), texture.getNumLayers());
+			it->second.setState(it->second.wholeResourceRange(), {VK_IMAGE_LAYOUT_UNDEFINED, transient.aliasMask});
+			texture._vkCurrentImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+
 	void RenderGraph::trackWindowSized(Texture& texture) {
 		trackWindowSized(texture, [](const Dimensions& dims) { return dims; });
 	}
@@ -992,9 +2478,10 @@ namespace mythril {
 			return;
 		ASSERT(cmd._wrapper->_cmdBuf);
 
-		std::vector<VkImageMemoryBarrier2> vkImageBarriers;
+		LinearArena& arena = cmd._ctx->getFrameArenaImpl();
+		ArenaVector<VkImageMemoryBarrier2> vkImageBarriers{ArenaAllocator<VkImageMemoryBarrier2>(arena)};
 		vkImageBarriers.reserve(compiledPass.imageBarriers.size());
-		std::vector<VkBufferMemoryBarrier2> vkBufferBarriers;
+		ArenaVector<VkBufferMemoryBarrier2> vkBufferBarriers{ArenaAllocator<VkBufferMemoryBarrier2>(arena)};
 		vkBufferBarriers.reserve(compiledPass.bufferBarriers.size());
 		// we have to update the image associated if its a swapchain image
 		// as it changes every frame
@@ -1005,45 +2492,12 @@ namespace mythril {
 				_resourceTrackers.emplace(activeHandle, TextureStateTracker{activeTexture.getNumMips(), activeTexture.getNumLayers()});
 			}
 			TextureStateTracker& tracker = _resourceTrackers.at(activeHandle);
-			const std::vector<TextureStateTracker::SubresourceEntry> currentStates = tracker.getOverlappingStates(req.range);
-			for (const auto& current: currentStates) {
-				if (!NeedsBarrier(current.state, req.dstLayout, req.dstMask))
-					continue;
-				vkImageBarriers.push_back(
-				        {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				         .srcStageMask = current.state.mask.stage,
-				         .srcAccessMask = current.state.mask.access,
-				         .dstStageMask = req.dstMask.stage,
-				         .dstAccessMask = req.dstMask.access,
-				         .oldLayout = current.state.layout,
-				         .newLayout = req.dstLayout,
-				         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-				         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-				         .image = activeTexture.getImage(),
-				         .subresourceRange = MakeVkRange(activeTexture.getFormat(), current.range)}
-				);
-			}
-			tracker.setState(req.range, {req.dstLayout, req.dstMask});
+			AppendImageBarriers(tracker, req, activeTexture.getImage(), activeTexture.getFormat(), vkImageBarriers);
 			cmd._ctx->access(activeHandle)._vkCurrentImageLayout = req.dstLayout;
 		}
 		for (const CompiledBufferBarrier& req: compiledPass.bufferBarriers) {
 			const AllocatedBuffer& buffer = cmd._ctx->view(req.handle);
-			const vkutil::StageAccess currentState = _bufferTrackers.contains(req.handle) ? _bufferTrackers.at(req.handle) : vkutil::StageAccess{};
-			if (NeedsBufferBarrier(currentState, req.dstMask)) {
-				vkBufferBarriers.push_back({
-					.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
-					.srcStageMask = currentState.stage,
-					.srcAccessMask = currentState.access,
-					.dstStageMask = req.dstMask.stage,
-					.dstAccessMask = req.dstMask.access,
-					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-					.buffer = buffer._vkBuffer,
-					.offset = 0,
-					.size = VK_WHOLE_SIZE}
-				);
-			}
-			_bufferTrackers[req.handle] = req.dstMask;
+			AppendBufferBarrier(_bufferTrackers[req.handle], req, buffer._vkBuffer, buffer._bufferSize, vkBufferBarriers);
 		}
 		if (!vkImageBarriers.empty() || !vkBufferBarriers.empty()) {
 			const VkDependencyInfo dependencyInfo = {
@@ -1058,16 +2512,668 @@ namespace mythril {
 		}
 	}
 
+	void RenderGraph::recordPass(CommandBuffer& cmd, uint32_t compiledIdx) {
+		CompiledPass& pass = _compiledPasses[compiledIdx];
+		// parallel passes already had their condition checked when their chunks were recorded
+		const bool isParallel = pass.chunkCount > 0 && !_parallelSecondaries.empty();
+		if (isParallel ? _parallelSecondaries[compiledIdx].empty() : pass.conditionCallback && !pass.conditionCallback())
+			return;
+		const bool isGraphics = pass.type == PassDesc::Type::Graphics;
+		const bool isTimed = _timestampPool != VK_NULL_HANDLE && _timestampMasks[static_cast<size_t>(pass.queue)] != 0;
+		const auto timingIdx = static_cast<uint32_t>(_timingFrame % kTimestampLatency * _compiledPasses.size() + compiledIdx);
+		if (isTimed) {
+			vkCmdResetQueryPool(cmd._wrapper->_cmdBuf, _timestampPool, timingIdx * 2, 2);
+			vkCmdWriteTimestamp2(cmd._wrapper->_cmdBuf, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _timestampPool, timingIdx * 2);
+		}
+		// perform batched vkCmdPipelineBarrier
+		if (_bakedBarriersReady)
+			recordBakedBarriers(cmd, _bakedBarriers[compiledIdx]);
+		else
+			PerformBarrierTransitions(cmd, pass);
+		// switch color attachment imageViews for Swapchain
+		if (!cmd._ctx->isHeadless()) {
+			const uint32_t swapIdx = cmd._ctx->_swapchain->getCurrentImageIndex();
+			for (auto& color: pass.colorAttachments) {
+				if (color.isSwapchainImage)
+					color.imageView = color.swapchainImageViews[swapIdx];
+			}
+			if (pass.depthAttachment && pass.depthAttachment->isSwapchainImage)
+				pass.depthAttachment->imageView = pass.depthAttachment->swapchainImageViews[swapIdx];
+		}
+		// reset current states
+		cmd._currentPipelineInfo = nullptr;
+		cmd._currentPipelineHandle = {};
+		cmd._activePass = &pass;
+		swapTextureVersions(pass);
+		if (isParallel || pass.isStatic) {
+			const VkCommandBuffer staticSecondary = pass.isStatic ? getStaticSecondary(cmd, compiledIdx) : VK_NULL_HANDLE;
+			const std::span<const VkCommandBuffer> secondaries = pass.isStatic ? std::span(&staticSecondary, 1) : std::span<const VkCommandBuffer>(_parallelSecondaries[compiledIdx]);
+			if (isGraphics) cmd.cmdBeginRenderingImpl(pass.layerCount, pass.viewMask, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+			vkCmdExecuteCommands(cmd._wrapper->_cmdBuf, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+			if (isGraphics) cmd.cmdEndRenderingImpl();
+			// whatever the secondaries bound is undefined for the primary afterwards
+			cmd._lastBoundvkPipeline = VK_NULL_HANDLE;
+		} else {
+			// we already checked if it has an execute callback so it should be guaranteed
+			if (isGraphics) cmd.cmdBeginRendering(pass.layerCount, pass.viewMask);
+			pass.executeCallback(cmd);
+			if (isGraphics) cmd.cmdEndRendering();
+		}
+		// the compiled passes can move on the next compile, nothing may keep pointing into them
+		cmd._activePass = nullptr;
+		swapTextureVersions(pass);
+		if (_bakedBarriersReady)
+			recordSplitSignals(cmd, _bakedBarriers[compiledIdx]);
+		if (isTimed) {
+			vkCmdWriteTimestamp2(cmd._wrapper->_cmdBuf, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, _timestampPool, timingIdx * 2 + 1);
+			_timestampWritten[timingIdx] = 1;
+		}
+	}
+
+	void RenderGraph::recordOwnershipReleases(CommandBuffer& cmd, const CrossQueueSync& sync, QueueAffinity queue) {
+		const CTX& ctx = *cmd._ctx;
+		LinearArena& arena = cmd._ctx->getFrameArenaImpl();
+		ArenaVector<VkImageMemoryBarrier2> vkImageBarriers{ArenaAllocator<VkImageMemoryBarrier2>(arena)};
+		ArenaVector<VkBufferMemoryBarrier2> vkBufferBarriers{ArenaAllocator<VkBufferMemoryBarrier2>(arena)};
+		for (const QueueOwnershipTransfer& transfer: sync.transfers) {
+			if (transfer.srcQueue != queue)
+				continue;
+			const uint32_t srcFamily = ctx.getQueueFamilyIndex(transfer.srcQueue);
+			const uint32_t dstFamily = ctx.getQueueFamilyIndex(transfer.dstQueue);
+			const auto dstQueue = static_cast<size_t>(transfer.dstQueue);
+			if (transfer.texture.valid()) {
+				// never touched means there is nothing to hand over, the consumer starts from undefined
+				auto it = _resourceTrackers.find(transfer.texture);
+				if (it == _resourceTrackers.end())
+					continue;
+				const AllocatedTexture& texture = ctx.view(transfer.texture);
+				TextureStateTracker& tracker = it->second;
+				for (const auto& current: tracker.getOverlappingStates(tracker.wholeResourceRange(), ArenaAllocator<TextureStateTracker::SubresourceEntry>(arena))) {
+					// undefined contents dont need to survive the transfer
+					if (current.state.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+						continue;
+					// layout stays put, the consumers own barrier handles any transition after the acquire
+					VkImageMemoryBarrier2 barrier = {
+					    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					    .srcStageMask = current.state.mask.stage,
+					    .srcAccessMask = current.state.mask.access,
+					    .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+					    .dstAccessMask = VK_ACCESS_2_NONE,
+					    .oldLayout = current.state.layout,
+					    .newLayout = current.state.layout,
+					    .srcQueueFamilyIndex = srcFamily,
+					    .dstQueueFamilyIndex = dstFamily,
+					    .image = texture.getImage(),
+					    .subresourceRange = MakeVkRange(texture.getFormat(), current.range)
+					};
+					vkImageBarriers.push_back(barrier);
+					// the acquire is the same barrier with the other half of the masks
+					barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+					barrier.srcAccessMask = VK_ACCESS_2_NONE;
+					barrier.dstStageMask = transfer.dstMask.stage;
+					barrier.dstAccessMask = transfer.dstMask.access;
+					_pendingImageAcquires[dstQueue].push_back(barrier);
+					tracker.setState(current.range, {current.state.layout, transfer.dstMask});
+				}
+			} else {
+				const AllocatedBuffer& buffer = ctx.view(transfer.buffer);
+				// ownership moves for the whole buffer, so the release has to cover every interval's last access
+				vkutil::StageAccess currentState{};
+				if (const auto it = _bufferTrackers.find(transfer.buffer); it != _bufferTrackers.end()) {
+					for (const BufferStateTracker::Interval& interval: it->second.getOverlappingStates(0, VK_WHOLE_SIZE, ArenaAllocator<BufferStateTracker::Interval>(arena))) {
+						currentState.stage |= interval.state.stage;
+						currentState.access |= interval.state.access;
+					}
+				}
+				// buffers have no undefined state, so even untracked ones get transferred
+				VkBufferMemoryBarrier2 barrier = {
+				    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+				    .srcStageMask = currentState.stage,
+				    .srcAccessMask = currentState.access,
+				    .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+				    .dstAccessMask = VK_ACCESS_2_NONE,
+				    .srcQueueFamilyIndex = srcFamily,
+				    .dstQueueFamilyIndex = dstFamily,
+				    .buffer = buffer._vkBuffer,
+				    .offset = 0,
+				    .size = VK_WHOLE_SIZE
+				};
+				vkBufferBarriers.push_back(barrier);
+				barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+				barrier.srcAccessMask = VK_ACCESS_2_NONE;
+				barrier.dstStageMask = transfer.dstMask.stage;
+				barrier.dstAccessMask = transfer.dstMask.access;
+				_pendingBufferAcquires[dstQueue].push_back(barrier);
+				_bufferTrackers[transfer.buffer].setState(transfer.dstMask);
+			}
+		}
+		if (vkImageBarriers.empty() && vkBufferBarriers.empty())
+			return;
+		const VkDependencyInfo dependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .bufferMemoryBarrierCount = static_cast<uint32_t>(vkBufferBarriers.size()),
+		    .pBufferMemoryBarriers = vkBufferBarriers.data(),
+		    .imageMemoryBarrierCount = static_cast<uint32_t>(vkImageBarriers.size()),
+		    .pImageMemoryBarriers = vkImageBarriers.data()
+		};
+		vkCmdPipelineBarrier2(cmd._wrapper->_cmdBuf, &dependencyInfo);
+	}
+
+	void RenderGraph::recordOwnershipAcquires(CommandBuffer& cmd, QueueAffinity queue) {
+		const auto q = static_cast<size_t>(queue);
+		std::vector<VkImageMemoryBarrier2>& vkImageBarriers = _pendingImageAcquires[q];
+		std::vector<VkBufferMemoryBarrier2>& vkBufferBarriers = _pendingBufferAcquires[q];
+		if (vkImageBarriers.empty() && vkBufferBarriers.empty())
+			return;
+		const VkDependencyInfo dependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .bufferMemoryBarrierCount = static_cast<uint32_t>(vkBufferBarriers.size()),
+		    .pBufferMemoryBarriers = vkBufferBarriers.data(),
+		    .imageMemoryBarrierCount = static_cast<uint32_t>(vkImageBarriers.size()),
+		    .pImageMemoryBarriers = vkImageBarriers.data()
+		};
+		vkCmdPipelineBarrier2(cmd._wrapper->_cmdBuf, &dependencyInfo);
+		vkImageBarriers.clear();
+		vkBufferBarriers.clear();
+	}
+
+	// records layer by layer, graphics work goes into cmd and async work into command buffers of their own queues
+	// a queue is only submitted when another queue has to wait on it, so graphics layers with nothing
+	// async in between still end up in a single submit
+	void RenderGraph::executeMultiQueue(CommandBuffer& cmd) {
+		CTX& ctx = *cmd._ctx;
+		ImmediateCommands* graphicsQueue = ctx._immGraphics.get();
+		ASSERT(cmd._wrapper);
+
+		// the swapchain acquire belongs to the first graphics submit that actually touches the swapchain
+		// not to whatever graphics work happens to be submitted first
+		VkSemaphore acquireSemaphore = graphicsQueue->acquireWaitSemaphore();
+		auto consumeAcquireSemaphore = [&] {
+			if (acquireSemaphore != VK_NULL_HANDLE)
+				graphicsQueue->waitSemaphore(std::exchange(acquireSemaphore, VK_NULL_HANDLE));
+		};
+
+		std::array<std::optional<CommandBuffer>, kQueueCount> asyncCmds;
+		std::array<bool, kQueueCount> hasRecorded{};
+		std::array<uint64_t, kQueueCount> lastValue{};
+		for (size_t q = 0; q < kQueueCount; ++q) {
+			if (const ImmediateCommands* imm = ctx.getQueue(static_cast<QueueAffinity>(q)))
+				lastValue[q] = imm->getLastTimelineValue();
+		}
+		auto queueCmd = [&](QueueAffinity queue) -> CommandBuffer& {
+			if (queue == QueueAffinity::Graphics)
+				return cmd;
+			std::optional<CommandBuffer>& asyncCmd = asyncCmds[static_cast<size_t>(queue)];
+			if (!asyncCmd)
+				asyncCmd.emplace(&ctx, CommandBuffer::Type::Compute, ctx.getQueue(queue));
+			return *asyncCmd;
+		};
+		auto flush = [&](QueueAffinity queue) {
+			const auto q = static_cast<size_t>(queue);
+			ImmediateCommands* imm = ctx.getQueue(queue);
+			if (queue == QueueAffinity::Graphics) {
+				cmd._lastSubmitHandle = imm->submit(*cmd._wrapper);
+				cmd._wrapper = &imm->acquire();
+			} else if (asyncCmds[q]) {
+				imm->submit(*asyncCmds[q]->_wrapper);
+				asyncCmds[q].reset();
+			}
+			hasRecorded[q] = false;
+			lastValue[q] = imm->getLastTimelineValue();
+		};
+		auto processBoundary = [&](const CrossQueueSync& sync) {
+			// producers release and submit first so the consumers have a timeline value to wait on
+			for (size_t p = 0; p < kQueueCount; ++p) {
+				if (!sync.signals[p])
+					continue;
+				const auto producer = static_cast<QueueAffinity>(p);
+				const bool releases = std::any_of(sync.transfers.begin(), sync.transfers.end(), [producer](const QueueOwnershipTransfer& t) { return t.srcQueue == producer; });
+				if (releases) {
+					recordOwnershipReleases(queueCmd(producer), sync, producer);
+					hasRecorded[p] = true;
+				}
+				if (hasRecorded[p])
+					flush(producer);
+			}
+			for (size_t c = 0; c < kQueueCount; ++c) {
+				if (std::none_of(sync.waits[c].begin(), sync.waits[c].end(), [](bool wait) { return wait; }))
+					continue;
+				const auto consumer = static_cast<QueueAffinity>(c);
+				// waits apply to a whole submit, dont hold back work that was recorded before the boundary
+				if (hasRecorded[c])
+					flush(consumer);
+				ImmediateCommands* imm = ctx.getQueue(consumer);
+				for (size_t p = 0; p < kQueueCount; ++p) {
+					if (sync.waits[c][p])
+						imm->waitTimelineSemaphore(ctx.getQueue(static_cast<QueueAffinity>(p))->getTimelineSemaphore(), lastValue[p]);
+				}
+				if (!_pendingImageAcquires[c].empty() || !_pendingBufferAcquires[c].empty()) {
+					recordOwnershipAcquires(queueCmd(consumer), consumer);
+					hasRecorded[c] = true;
+				}
+			}
+		};
+
+		for (size_t depth = 0; depth < _layerByQueue.size(); ++depth) {
+			processBoundary(_layerSyncs[depth]);
+			for (size_t q = 0; q < kQueueCount; ++q) {
+				const auto queue = static_cast<QueueAffinity>(q);
+				for (const uint32_t compiled_idx: _layerByQueue[depth][q]) {
+					if (_compiledPasses[compiled_idx].usesSwapchain)
+						consumeAcquireSemaphore();
+					recordPass(queueCmd(queue), compiled_idx);
+					hasRecorded[q] = true;
+				}
+			}
+		}
+		// hands everything back to graphics, the last graphics chunk stays open for the present transition
+		processBoundary(_layerSyncs.back());
+		ASSERT(std::none_of(asyncCmds.begin(), asyncCmds.end(), [](const std::optional<CommandBuffer>& c) { return c.has_value(); }));
+		consumeAcquireSemaphore();
+	}
+
+	// simulates two frames over copies of the trackers, the first one settles every resource into the state
+	// a frame leaves it in and the second one is what gets recorded from then on. only possible when the
+	// frame is identical every time, so async queues and condition callbacks stay on the tracked path
+	// barriers of the second frame whose producer ran at least two passes earlier are split into an event pair
+	void RenderGraph::bakeBarrierBatches(CTX& rCtx) {
+		destroySplitEvents();
+		_bakedBarriers.clear();
+		_bakedBarriers.resize(_compiledPasses.size());
+		_bakedBarriersReady = false;
+		_canUseBakedBarriers = !_hasAsyncWork && std::none_of(_compiledPasses.begin(), _compiledPasses.end(), [](const CompiledPass& pass) { return pass.conditionCallback != nullptr; });
+		if (!_canUseBakedBarriers)
+			return;
+
+		std::unordered_map<TextureHandle, TextureStateTracker> trackers = _resourceTrackers;
+		std::unordered_map<BufferHandle, BufferStateTracker> bufferTrackers = _bufferTrackers;
+		// only the current swapchain image is ever used, so they can all share one tracker
+		TextureStateTracker swapchainTracker{1, 1};
+		const vkutil::StageAccess presentMask = vkutil::GetPipelineStageAccess(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		// which pass last touched what within the simulated frame, states carried over from the previous frame have no producer
+		struct TextureAccess {
+			SubresourceRange range;
+			uint32_t passIdx;
+		};
+		std::unordered_map<TextureHandle, std::vector<TextureAccess>> textureAccesses;
+		std::unordered_map<BufferHandle, uint32_t> bufferAccesses;
+		// (producer, consumer) -> index into _splitBarriers
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> splitLookup;
+		const auto getSplit = [&](uint32_t producer, uint32_t consumer) -> SplitBarrier& {
+			const auto [it, inserted] = splitLookup.try_emplace({producer, consumer}, static_cast<uint32_t>(_splitBarriers.size()));
+			if (inserted)
+				_splitBarriers.push_back({.producer = producer, .consumer = consumer});
+			return _splitBarriers[it->second];
+		};
+		// a pass directly after its producer gains nothing from an event
+		const auto isSplittable = [](std::optional<uint32_t> producer, uint32_t consumer) {
+			return producer && consumer - *producer >= 2;
+		};
+		std::vector<VkImageMemoryBarrier2> scratchImageBarriers;
+		std::vector<VkBufferMemoryBarrier2> scratchBufferBarriers;
+
+		for (int frame = 0; frame < 2; ++frame) {
+			const bool isRecordedFrame = frame == 1;
+			for (BakedBarrierBatch& batch: _bakedBarriers) {
+				batch.imageBarriers.clear();
+				batch.bufferBarriers.clear();
+				batch.swapchainBarriers.clear();
+				batch.layouts.clear();
+			}
+			textureAccesses.clear();
+			bufferAccesses.clear();
+			// mirror what execute does at the edges of a frame
+			swapchainTracker.setState(swapchainTracker.wholeResourceRange(), {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, presentMask});
+			for (const TransientTexture& transient: _transientTextures) {
+				const AllocatedTexture& texture = rCtx.view(transient.texture.handle());
+				if (texture.getImageView() == VK_NULL_HANDLE)
+					continue;
+				TextureStateTracker& tracker = trackers.try_emplace(transient.texture.handle(), texture.getNumMips(), texture.getNumLayers()).first->second;
+				tracker.setState(tracker.wholeResourceRange(), {VK_IMAGE_LAYOUT_UNDEFINED, transient.aliasMask});
+			}
+
+			for (uint32_t i = 0; i < static_cast<uint32_t>(_compiledPasses.size()); ++i) {
+				const CompiledPass& pass = _compiledPasses[i];
+				BakedBarrierBatch& batch = _bakedBarriers[i];
+				for (const CompiledImageBarrier& req: pass.imageBarriers) {
+					const AllocatedTexture& texture = rCtx.view(req.handle);
+					if (req.isSwapchain) {
+						// the swapchain barrier gets patched every frame, it always stays in the batch
+						const auto first = static_cast<uint32_t>(batch.imageBarriers.size());
+						AppendImageBarriers(swapchainTracker, req, VK_NULL_HANDLE, texture.getFormat(), batch.imageBarriers);
+						for (uint32_t b = first; b < batch.imageBarriers.size(); ++b)
+							batch.swapchainBarriers.push_back(b);
+					} else {
+						TextureStateTracker& tracker = trackers.try_emplace(req.handle, texture.getNumMips(), texture.getNumLayers()).first->second;
+						std::vector<TextureAccess>& accesses = textureAccesses[req.handle];
+						// the nearest earlier pass touching any of the range, an event set after it also covers everything before it
+						std::optional<uint32_t> producer;
+						for (auto it = accesses.rbegin(); it != accesses.rend() && !producer; ++it) {
+							if (it->passIdx != i && it->range.overlaps(req.range))
+								producer = it->passIdx;
+						}
+						if (isRecordedFrame && isSplittable(producer, i)) {
+							scratchImageBarriers.clear();
+							AppendImageBarriers(tracker, req, texture.getImage(), texture.getFormat(), scratchImageBarriers);
+							if (!scratchImageBarriers.empty()) {
+								SplitBarrier& split = getSplit(*producer, i);
+								split.imageBarriers.insert(split.imageBarriers.end(), scratchImageBarriers.begin(), scratchImageBarriers.end());
+							}
+						} else {
+							AppendImageBarriers(tracker, req, texture.getImage(), texture.getFormat(), batch.imageBarriers);
+						}
+						accesses.push_back({req.range, i});
+					}
+					batch.layouts.push_back({.handle = req.handle, .layout = req.dstLayout, .isSwapchain = req.isSwapchain});
+				}
+				for (const CompiledBufferBarrier& req: pass.bufferBarriers) {
+					const AllocatedBuffer& buffer = rCtx.view(req.handle);
+					const auto accessIt = bufferAccesses.find(req.handle);
+					const std::optional<uint32_t> producer = accessIt != bufferAccesses.end() ? std::optional(accessIt->second) : std::nullopt;
+					if (isRecordedFrame && isSplittable(producer, i)) {
+						scratchBufferBarriers.clear();
+						AppendBufferBarrier(bufferTrackers[req.handle], req, buffer._vkBuffer, buffer._bufferSize, scratchBufferBarriers);
+						if (!scratchBufferBarriers.empty()) {
+							SplitBarrier& split = getSplit(*producer, i);
+							split.bufferBarriers.insert(split.bufferBarriers.end(), scratchBufferBarriers.begin(), scratchBufferBarriers.end());
+						}
+					} else {
+						AppendBufferBarrier(bufferTrackers[req.handle], req, buffer._vkBuffer, buffer._bufferSize, batch.bufferBarriers);
+					}
+					bufferAccesses[req.handle] = i;
+				}
+			}
+		}
+		for (BakedBarrierBatch& batch: _bakedBarriers) {
+			batch.dependencyInfo = {
+			    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			    .bufferMemoryBarrierCount = static_cast<uint32_t>(batch.bufferBarriers.size()),
+			    .pBufferMemoryBarriers = batch.bufferBarriers.data(),
+			    .imageMemoryBarrierCount = static_cast<uint32_t>(batch.imageBarriers.size()),
+			    .pImageMemoryBarriers = batch.imageBarriers.data()
+			};
+		}
+		if (_splitBarriers.empty())
+			return;
+		// events are only ever touched by the device, set after the producer and waited on before the consumer
+		const VkEventCreateInfo event_ci = {
+			.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+			.flags = VK_EVENT_CREATE_DEVICE_ONLY_BIT
+		};
+		_deviceCtx = &rCtx;
+		for (uint32_t s = 0; s < static_cast<uint32_t>(_splitBarriers.size()); ++s) {
+			SplitBarrier& split = _splitBarriers[s];
+			VK_CHECK(vkCreateEvent(rCtx._vkDevice, &event_ci, nullptr, &split.event));
+			split.dependencyInfo = {
+			    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			    .bufferMemoryBarrierCount = static_cast<uint32_t>(split.bufferBarriers.size()),
+			    .pBufferMemoryBarriers = split.bufferBarriers.data(),
+			    .imageMemoryBarrierCount = static_cast<uint32_t>(split.imageBarriers.size()),
+			    .pImageMemoryBarriers = split.imageBarriers.data()
+			};
+			for (const VkImageMemoryBarrier2& barrier: split.imageBarriers)
+				split.dstStageMask |= barrier.dstStageMask;
+			for (const VkBufferMemoryBarrier2& barrier: split.bufferBarriers)
+				split.dstStageMask |= barrier.dstStageMask;
+			_bakedBarriers[split.producer].signalSplits.push_back(s);
+			BakedBarrierBatch& consumerBatch = _bakedBarriers[split.consumer];
+			consumerBatch.waitSplits.push_back(s);
+			consumerBatch.waitEvents.push_back(split.event);
+			consumerBatch.waitInfos.push_back(split.dependencyInfo);
+		}
+		LOG_SYSTEM(LogType::Info, "Split {} RenderGraph barriers into event pairs.", _splitBarriers.size());
+	}
+
+	void RenderGraph::destroySplitEvents() {
+		if (_deviceCtx) {
+			for (const SplitBarrier& split: _splitBarriers) {
+				_deviceCtx->deferTask(std::packaged_task<void()>([device = _deviceCtx->_vkDevice, event = split.event]() { vkDestroyEvent(device, event, nullptr); }));
+			}
+		}
+		_splitBarriers.clear();
+	}
+
+	// two queries per pass for every frame that can still be in flight when its results are read
+	void RenderGraph::createTimestampPool(CTX& rCtx) {
+		destroyTimestampPool();
+		_passTimings.clear();
+		_timingHistories.clear();
+		if (!_passTimingsEnabled || _compiledPasses.empty())
+			return;
+		const auto numPasses = static_cast<uint32_t>(_compiledPasses.size());
+		_timestampPeriod = rCtx.getPhysicalDeviceProperties10().limits.timestampPeriod;
+		uint32_t numFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(rCtx._vkPhysicalDevice, &numFamilies, nullptr);
+		std::vector<VkQueueFamilyProperties> familyProperties(numFamilies);
+		vkGetPhysicalDeviceQueueFamilyProperties(rCtx._vkPhysicalDevice, &numFamilies, familyProperties.data());
+		for (size_t q = 0; q < kQueueCount; ++q) {
+			const auto queue = static_cast<QueueAffinity>(q);
+			// queries are reset in the command buffer, which transfer only queues cant do
+			if (!rCtx.getQueue(queue) || queue == QueueAffinity::AsyncTransfer) {
+				_timestampMasks[q] = 0;
+				continue;
+			}
+			const uint32_t validBits = familyProperties[rCtx.getQueueFamilyIndex(queue)].timestampValidBits;
+			_timestampMasks[q] = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		}
+		if (_timestampPeriod == 0.f || std::all_of(_timestampMasks.begin(), _timestampMasks.end(), [](uint64_t mask) { return mask == 0; })) {
+			LOG_SYSTEM(LogType::Warning, "RenderGraph pass timings unavailable: No queue in use supports timestamps.");
+			return;
+		}
+		const VkQueryPoolCreateInfo query_pool_ci = {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = kTimestampLatency * numPasses * 2
+		};
+		VK_CHECK(vkCreateQueryPool(rCtx._vkDevice, &query_pool_ci, nullptr, &_timestampPool));
+		vkutil::SetObjectDebugName(rCtx._vkDevice, VK_OBJECT_TYPE_QUERY_POOL, reinterpret_cast<uint64_t>(_timestampPool), "RenderGraph: Timestamp QueryPool");
+		_deviceCtx = &rCtx;
+		_timingFrame = 0;
+		_timestampWritten.assign(kTimestampLatency * numPasses, 0);
+		_timingHistories.resize(numPasses);
+		_passTimings.resize(numPasses);
+		for (uint32_t i = 0; i < numPasses; ++i) {
+			_passTimings[i].name = _compiledPasses[i].name;
+			_passTimings[i].queue = _compiledPasses[i].queue;
+		}
+	}
+
+	void RenderGraph::destroyTimestampPool() {
+		if (_timestampPool != VK_NULL_HANDLE) {
+			_deviceCtx->deferTask(std::packaged_task<void()>([device = _deviceCtx->_vkDevice, pool = _timestampPool]() { vkDestroyQueryPool(device, pool, nullptr); }));
+			_timestampPool = VK_NULL_HANDLE;
+		}
+		_timestampWritten.clear();
+	}
+
+	// reads back the slot this frame is about to reuse, anything the gpu hasnt finished yet is simply dropped
+	void RenderGraph::collectPassTimings(CTX& rCtx) {
+		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
+		const auto numPasses = static_cast<uint32_t>(_compiledPasses.size());
+		const uint32_t slot = static_cast<uint32_t>(_timingFrame % kTimestampLatency);
+		for (uint32_t i = 0; i < numPasses; ++i) {
+			uint8_t& written = _timestampWritten[slot * numPasses + i];
+			if (!written)
+				continue;
+			written = 0;
+			// value and availability for the begin and end query
+			uint64_t results[4] = {};
+			const uint32_t firstQuery = (slot * numPasses + i) * 2;
+			const VkResult result = vkGetQueryPoolResults(rCtx._vkDevice, _timestampPool, firstQuery, 2, sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			if ((result != VK_SUCCESS && result != VK_NOT_READY) || !results[1] || !results[3])
+				continue;
+			const uint64_t mask = _timestampMasks[static_cast<size_t>(_compiledPasses[i].queue)];
+			const float ms = static_cast<float>(static_cast<double>((results[2] - results[0]) & mask) * _timestampPeriod * 1e-6);
+
+			PassTimingHistory& history = _timingHistories[i];
+			history.samples[history.head] = ms;
+			history.head = (history.head + 1) % PassTimingHistory::kNumSamples;
+			history.count = std::min(history.count + 1, PassTimingHistory::kNumSamples);
+
+			PassTiming& timing = _passTimings[i];
+			timing.lastMs = ms;
+			timing.minMs = ms;
+			timing.maxMs = ms;
+			float sum = 0.f;
+			for (uint32_t s = 0; s < history.count; ++s) {
+				timing.minMs = std::min(timing.minMs, history.samples[s]);
+				timing.maxMs = std::max(timing.maxMs, history.samples[s]);
+				sum += history.samples[s];
+			}
+			timing.avgMs = sum / static_cast<float>(history.count);
+			timing.numSamples = history.count;
+		}
+	}
+
+	void RenderGraph::recordBakedBarriers(CommandBuffer& cmd, BakedBarrierBatch& batch) {
+		CTX& ctx = *cmd._ctx;
+		if (!batch.waitEvents.empty())
+			vkCmdWaitEvents2(cmd._wrapper->_cmdBuf, static_cast<uint32_t>(batch.waitEvents.size()), batch.waitEvents.data(), batch.waitInfos.data());
+		if (!batch.swapchainBarriers.empty()) {
+			const AllocatedTexture& swapchainTexture = ctx.view(ctx.getCurrentSwapchainTexHandle());
+			for (const uint32_t idx: batch.swapchainBarriers) {
+				VkImageMemoryBarrier2& barrier = batch.imageBarriers[idx];
+				barrier.image = swapchainTexture.getImage();
+				// the bake assumes the image was presented last frame, a freshly created one is still undefined
+				if (barrier.oldLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+					barrier.oldLayout = swapchainTexture.getImageLayout();
+			}
+		}
+		if (batch.dependencyInfo.imageMemoryBarrierCount || batch.dependencyInfo.bufferMemoryBarrierCount)
+			vkCmdPipelineBarrier2(cmd._wrapper->_cmdBuf, &batch.dependencyInfo);
+		for (const BakedBarrierBatch::LayoutUpdate& update: batch.layouts)
+			ctx.access(update.isSwapchain ? ctx.getCurrentSwapchainTexHandle() : update.handle)._vkCurrentImageLayout = update.layout;
+	}
+
+	// runs once the pass itself is recorded, outside of any rendering
+	void RenderGraph::recordSplitSignals(CommandBuffer& cmd, const BakedBarrierBatch& batch) {
+		const VkCommandBuffer cmdBuf = cmd._wrapper->_cmdBuf;
+		// unsignal whatever this pass waited on once its stages are done, ready for the next frame to set again
+		for (const uint32_t idx: batch.waitSplits) {
+			const SplitBarrier& split = _splitBarriers[idx];
+			vkCmdResetEvent2(cmdBuf, split.event, split.dstStageMask);
+		}
+		for (const uint32_t idx: batch.signalSplits) {
+			const SplitBarrier& split = _splitBarriers[idx];
+			vkCmdSetEvent2(cmdBuf, split.event, &split.dependencyInfo);
+		}
+	}
+
+	// records every chunk of every parallel pass up front, recordPass later executes them in graph order
+	// each chunk gets its own secondary from the pool of whichever thread picked it up
+	void RenderGraph::recordParallelPasses(CommandBuffer& cmd) {
+		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
+		CTX& ctx = *cmd._ctx;
+		struct ParallelChunk {
+			uint32_t compiledIdx;
+			uint32_t chunk;
+		};
+		// workers only read it, all allocation happens up front on this thread
+		ArenaVector<ParallelChunk> chunks{ArenaAllocator<ParallelChunk>(ctx.getFrameArenaImpl())};
+		std::array<bool, kQueueCount> usedQueues{};
+		_parallelSecondaries.resize(_compiledPasses.size());
+		for (uint32_t i = 0; i < static_cast<uint32_t>(_compiledPasses.size()); ++i) {
+			const CompiledPass& pass = _compiledPasses[i];
+			_parallelSecondaries[i].clear();
+			if (pass.chunkCount == 0 || (pass.conditionCallback && !pass.conditionCallback()))
+				continue;
+			_parallelSecondaries[i].resize(pass.chunkCount);
+			for (uint32_t chunk = 0; chunk < pass.chunkCount; ++chunk)
+				chunks.push_back({i, chunk});
+			usedQueues[static_cast<size_t>(_hasAsyncWork ? pass.queue : QueueAffinity::Graphics)] = true;
+		}
+		if (chunks.empty())
+			return;
+
+		// bindless updates touch the CTX, get them out of the way before any worker binds a pipeline
+		ctx.checkAndUpdateBindlessDescriptorSetImpl();
+		WorkerPool& workers = ctx.getWorkerPoolImpl();
+		for (size_t q = 0; q < kQueueCount; ++q) {
+			if (usedQueues[q])
+				ctx.getQueue(static_cast<QueueAffinity>(q))->beginSecondaryFrame(workers.getNumThreads());
+		}
+		auto recordChunk = [&](uint32_t task, uint32_t thread) {
+			const ParallelChunk& chunk = chunks[task];
+			const CompiledPass& pass = _compiledPasses[chunk.compiledIdx];
+			ImmediateCommands* queue = ctx.getQueue(_hasAsyncWork ? pass.queue : QueueAffinity::Graphics);
+			CommandBuffer secondary(&ctx, cmd._cmdType, queue->acquireSecondary(thread));
+			secondary.beginSecondaryImpl(pass);
+			pass.parallelCallback(secondary, chunk.chunk);
+			secondary.endSecondaryImpl();
+			_parallelSecondaries[chunk.compiledIdx][chunk.chunk] = secondary._wrapper->_cmdBuf;
+		};
+		// a single reference fits the std::function small buffer, the full capture list would be heap allocated every frame
+		workers.dispatch(static_cast<uint32_t>(chunks.size()), [&recordChunk](uint32_t task, uint32_t thread) { recordChunk(task, thread); });
+	}
+
+	// static passes are recorded the first time they run and replayed until something they could refer to changes
+	VkCommandBuffer RenderGraph::getStaticSecondary(CommandBuffer& cmd, uint32_t compiledIdx) {
+		CTX& ctx = *cmd._ctx;
+		if (_staticCommandEpoch != ctx._commandEpoch)
+			invalidateStaticPasses();
+		_staticCommandEpoch = ctx._commandEpoch;
+		_staticSecondaries.resize(_compiledPasses.size(), VK_NULL_HANDLE);
+		if (_staticSecondaries[compiledIdx] != VK_NULL_HANDLE)
+			return _staticSecondaries[compiledIdx];
+
+		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
+		const CompiledPass& pass = _compiledPasses[compiledIdx];
+		const QueueAffinity queue = _hasAsyncWork ? pass.queue : QueueAffinity::Graphics;
+		VkCommandPool& pool = _staticCommandPools[static_cast<size_t>(queue)];
+		if (pool == VK_NULL_HANDLE) {
+			const VkCommandPoolCreateInfo command_pool_ci = {
+			    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			    .queueFamilyIndex = ctx.getQueueFamilyIndex(queue)
+			};
+			VK_CHECK(vkCreateCommandPool(ctx._vkDevice, &command_pool_ci, nullptr, &pool));
+			vkutil::SetObjectDebugName(ctx._vkDevice, VK_OBJECT_TYPE_COMMAND_POOL, reinterpret_cast<uint64_t>(pool), "RenderGraph: Static CommandPool");
+			_deviceCtx = &ctx;
+		}
+		const VkCommandBufferAllocateInfo command_buffer_ai = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		    .commandPool = pool,
+		    .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+		    .commandBufferCount = 1
+		};
+		ImmediateCommands::CommandBufferWrapper wrapper;
+		VK_CHECK(vkAllocateCommandBuffers(ctx._vkDevice, &command_buffer_ai, &wrapper._cmdBufAllocated));
+		wrapper._cmdBuf = wrapper._cmdBufAllocated;
+		vkutil::SetObjectDebugName(ctx._vkDevice, VK_OBJECT_TYPE_COMMAND_BUFFER, reinterpret_cast<uint64_t>(wrapper._cmdBuf), pass.name.c_str());
+
+		// bindless updates touch the CTX, same as before any parallel recording
+		ctx.checkAndUpdateBindlessDescriptorSetImpl();
+		CommandBuffer secondary(&ctx, cmd._cmdType, wrapper);
+		secondary.beginSecondaryImpl(pass, true);
+		pass.executeCallback(secondary);
+		secondary.endSecondaryImpl();
+		// whatever the recording itself resolved must not immediately invalidate it again
+		_staticCommandEpoch = ctx._commandEpoch;
+		LOG_SYSTEM(LogType::Info, "Recorded static pass '{}'.", pass.name);
+		_staticSecondaries[compiledIdx] = wrapper._cmdBuf;
+		return wrapper._cmdBuf;
+	}
+
+	// the pools may still be referenced by frames in flight, destroying one frees every secondary it handed out
+	void RenderGraph::invalidateStaticPasses() {
+		for (VkCommandPool& pool: _staticCommandPools) {
+			if (pool == VK_NULL_HANDLE)
+				continue;
+			_deviceCtx->deferTask(std::packaged_task<void()>([device = _deviceCtx->_vkDevice, pool]() { vkDestroyCommandPool(device, pool, nullptr); }));
+			pool = VK_NULL_HANDLE;
+		}
+		_staticSecondaries.clear();
+		_numWarmFrames = 0;
+	}
+
 	// will be the only execute but left for now
 	void RenderGraph::execute(CTX& rCtx) {
 		MYTH_PROFILER_FUNCTION_COLOR(MYTH_PROFILER_COLOR_RENDERGRAPH);
 		ASSERT_MSG(_hasCompiled, "A RenderGraph must be compiled before it can be executed!");
 
-		ASSERT_MSG(!rCtx.isHeadless(), "headless is currently not supported");
-
 		// auto-recompile if any resource topology changed since last compile
 		// (texture resize, swapchain recreate/destroy).
-		if (_compiledEpoch != rCtx._resourceEpoch) {
+		if (_compiledEpoch != rCtx._resourceEpoch && !refreshResources(rCtx)) {
 			LOG_SYSTEM(LogType::Info, "Performing recompile on RenderGraph!");
 			compile(rCtx);
 		}
@@ -1083,45 +3189,47 @@ namespace mythril {
 		ASSERT_MSG(_hasCompiled, "RenderGraph must be compiled before it can be executed!");
 		// auto-recompile if any resource topology changed since last compile (texture resize, swapchain recreate/destroy).
 		// single uint64 compare on the hot path; recompile only runs when actually stale (typically window-resize frames).
-		if (_compiledEpoch != cmd._ctx->_resourceEpoch) {
+		if (_compiledEpoch != cmd._ctx->_resourceEpoch && !refreshResources(*cmd._ctx)) {
 			compile(*cmd._ctx);
 		}
+#ifdef MYTH_ENABLED_ALLOCATION_TRACKING
+		const uint64_t numAllocationsBefore = GetNumHeapAllocations();
+#endif
 
-		for (CompiledPass& pass: _compiledPasses) {
-			if (pass.conditionCallback && !pass.conditionCallback())
-				continue;
-			const bool isGraphics = pass.type == PassDesc::Type::Graphics;
-			// perform batched vkCmdPipelineBarrier
-			PerformBarrierTransitions(cmd, pass);
-			// switch color attachment imageViews for Swapchain
-			if (!cmd._ctx->isHeadless()) {
-				const uint32_t swapIdx = cmd._ctx->_swapchain->getCurrentImageIndex();
-				for (auto& color: pass.colorAttachments) {
-					if (color.isSwapchainImage)
-						color.imageView = color.swapchainImageViews[swapIdx];
-				}
-				if (pass.depthAttachment && pass.depthAttachment->isSwapchainImage)
-					pass.depthAttachment->imageView = pass.depthAttachment->swapchainImageViews[swapIdx];
-			}
-			// reset current states
-			cmd._currentPipelineInfo = nullptr;
-			cmd._currentPipelineHandle = {};
-			cmd._activePass = pass;
-			// we already checked if it has an execute callback so it should be guaranteed
-			if (isGraphics) cmd.cmdBeginRendering(pass.layerCount, pass.viewMask);
-			pass.executeCallback(cmd);
-			if (isGraphics) cmd.cmdEndRendering();
+		if (_timestampPool != VK_NULL_HANDLE)
+			collectPassTimings(*cmd._ctx);
+		// baked barriers already start every transient from its reset state
+		if (!_bakedBarriersReady)
+			resetTransientStates(*cmd._ctx);
+		if (_hasParallelPasses)
+			recordParallelPasses(cmd);
+		if (_hasAsyncWork) {
+			executeMultiQueue(cmd);
+		} else {
+			for (uint32_t i = 0; i < static_cast<uint32_t>(_compiledPasses.size()); ++i)
+				recordPass(cmd, i);
 		}
 		if (!cmd._ctx->isHeadless()) {
 			// fixme: make this cleaner im so lazy right now
 			cmd.cmdTransitionLayout(cmd._ctx->getCurrentSwapchainTexHandle(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 			const vkutil::StageAccess dstMask = vkutil::GetPipelineStageAccess(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 			const TextureHandle currentSwapchainHandle = cmd._ctx->getCurrentSwapchainTexHandle();
-			if (_resourceTrackers.contains(currentSwapchainHandle)) {
+			if (!_bakedBarriersReady && _resourceTrackers.contains(currentSwapchainHandle)) {
 				TextureStateTracker& tracker = _resourceTrackers.at(currentSwapchainHandle);
 				tracker.setState(tracker.wholeResourceRange(), SubresourceState{VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, dstMask});
 			}
 			cmd._ctx->access(currentSwapchainHandle)._vkCurrentImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 		}
+		// this frame ended in exactly the state the bake started its second frame from
+		_bakedBarriersReady = _canUseBakedBarriers;
+		_timingFrame++;
+#ifdef MYTH_ENABLED_ALLOCATION_TRACKING
+		// once every frame arena grew to size and static passes are recorded, a frame should never touch the heap
+		// the count is process wide, so other threads allocating at the same time show up here too
+		constexpr uint32_t kNumWarmupFrames = 8;
+		const uint64_t numAllocations = GetNumHeapAllocations() - numAllocationsBefore;
+		ASSERT_MSG(_numWarmFrames < kNumWarmupFrames || numAllocations == 0, "RenderGraph::execute made {} heap allocations on a warm frame!", numAllocations);
+		_numWarmFrames++;
+#endif
 	}
 } // namespace mythril
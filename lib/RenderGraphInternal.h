@@ -14,8 +14,11 @@
 #include "vkutil.h"
 
 #include <algorithm>
+#include <array>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -58,6 +61,18 @@ namespace mythril {
         }
     };
 
+    // flat adjacency in compressed sparse rows, the neighbours of node i are edges[offsets[i]..offsets[i + 1])
+    // two arrays for the whole graph instead of a container per pass, which is what keeps huge graphs cheap to walk
+    struct AdjacencyList {
+        std::vector<uint32_t> offsets{0};
+        std::vector<uint32_t> edges;
+
+        std::span<const uint32_t> operator[](uint32_t node) const {
+            return {edges.data() + offsets[node], edges.data() + offsets[node + 1]};
+        }
+        uint32_t degree(uint32_t node) const { return offsets[node + 1] - offsets[node]; }
+    };
+
     struct SubresourceState {
         VkImageLayout layout; // uint32_t
         StageAccess mask;     // uint64_t pair
@@ -108,31 +123,73 @@ namespace mythril {
         }
     };
 
+    // a single state while the whole resource agrees, otherwise a dense mip-major array of every subresource
+    // per-mip passes on something like a cubemap would otherwise keep splitting rectangles on every set
     class TextureStateTracker {
     public:
         TextureStateTracker(uint32_t mips, uint32_t layers)
-            : totalMips(mips), totalLayers(layers) {
-            subresourceStates.push_back({wholeResourceRange(), {}});
-        }
+            : totalMips(mips), totalLayers(layers) {}
         struct SubresourceEntry {
             SubresourceRange range;
             SubresourceState state;
         };
         SubresourceState getState(const SubresourceRange& range) const {
-            // check for exact or containing range
-            for (auto& entry: subresourceStates) {
-                if (entry.range == range || entry.range.contains(range)) {
-                    return entry.state;
+            if (isUniform())
+                return uniformState;
+            // only meaningful when the whole range agrees, otherwise return undefined state
+            const SubresourceRange clamped = clamp(range);
+            if (clamped.numMips == 0 || clamped.numLayers == 0)
+                return {};
+            const SubresourceState& first = at(clamped.baseMip, clamped.baseLayer);
+            for (uint32_t mip = clamped.baseMip; mip < clamped.baseMip + clamped.numMips; ++mip) {
+                for (uint32_t layer = clamped.baseLayer; layer < clamped.baseLayer + clamped.numLayers; ++layer) {
+                    if (at(mip, layer) != first)
+                        return {};
                 }
             }
-            // not found then return undefined state
-            return {};
+            return first;
         }
-        std::vector<SubresourceEntry> getOverlappingStates(const SubresourceRange& range) const {
-            std::vector<SubresourceEntry> overlappingStates;
-            for (const auto& entry : subresourceStates) {
-                if (!entry.range.overlaps(range)) continue;
-                overlappingStates.push_back({intersect(entry.range, range), entry.state});
+        // coalesces equal neighbours so callers end up with as few barriers as possible
+        // pass an arena allocator when calling from the frame path, the default one uses the heap
+        template<typename Alloc = std::allocator<SubresourceEntry>>
+        std::vector<SubresourceEntry, Alloc> getOverlappingStates(const SubresourceRange& range, const Alloc& alloc = Alloc()) const {
+            using IndexAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<size_t>;
+            std::vector<SubresourceEntry, Alloc> overlappingStates(alloc);
+            const SubresourceRange clamped = clamp(range);
+            if (clamped.numMips == 0 || clamped.numLayers == 0)
+                return overlappingStates;
+            if (isUniform()) {
+                overlappingStates.push_back({clamped, uniformState});
+                return overlappingStates;
+            }
+            const uint32_t mipEnd = clamped.baseMip + clamped.numMips;
+            const uint32_t layerEnd = clamped.baseLayer + clamped.numLayers;
+            // runs ending at the previous mip, in layer order, which the current mip can extend downwards
+            std::vector<size_t, IndexAlloc> openRuns{IndexAlloc(alloc)};
+            std::vector<size_t, IndexAlloc> nextOpenRuns{IndexAlloc(alloc)};
+            for (uint32_t mip = clamped.baseMip; mip < mipEnd; ++mip) {
+                nextOpenRuns.clear();
+                size_t openIdx = 0;
+                uint32_t layer = clamped.baseLayer;
+                while (layer < layerEnd) {
+                    const SubresourceState& state = at(mip, layer);
+                    const uint32_t runBegin = layer;
+                    while (layer < layerEnd && at(mip, layer) == state)
+                        ++layer;
+                    while (openIdx < openRuns.size() && overlappingStates[openRuns[openIdx]].range.baseLayer < runBegin)
+                        ++openIdx;
+                    if (openIdx < openRuns.size()) {
+                        SubresourceEntry& above = overlappingStates[openRuns[openIdx]];
+                        if (above.range.baseLayer == runBegin && above.range.numLayers == layer - runBegin && above.state == state) {
+                            ++above.range.numMips;
+                            nextOpenRuns.push_back(openRuns[openIdx]);
+                            continue;
+                        }
+                    }
+                    nextOpenRuns.push_back(overlappingStates.size());
+                    overlappingStates.push_back({{mip, 1, runBegin, layer - runBegin}, state});
+                }
+                std::swap(openRuns, nextOpenRuns);
             }
             return overlappingStates;
         }
@@ -140,23 +197,20 @@ namespace mythril {
             if (range.numMips == 0 || range.numLayers == 0) {
                 range = wholeResourceRange();
             }
+            range = clamp(range);
             if (range == wholeResourceRange()) {
+                uniformState = state;
                 subresourceStates.clear();
-                subresourceStates.push_back({range, state});
                 return;
             }
-
-            std::vector<SubresourceEntry> nextStates;
-            nextStates.reserve(subresourceStates.size() + 4);
-            for (const auto& entry : subresourceStates) {
-                if (!entry.range.overlaps(range)) {
-                    nextStates.push_back(entry);
-                    continue;
-                }
-                appendDifference(nextStates, entry, range);
+            if (isUniform()) {
+                if (uniformState == state)
+                    return;
+                subresourceStates.assign(static_cast<size_t>(totalMips) * totalLayers, uniformState);
+            }
+            for (uint32_t mip = range.baseMip; mip < range.baseMip + range.numMips; ++mip) {
+                std::fill_n(subresourceStates.begin() + index(mip, range.baseLayer), range.numLayers, state);
             }
-            nextStates.push_back({range, state});
-            subresourceStates = std::move(nextStates);
         }
         uint32_t getTotalMips() const { return totalMips; }
         uint32_t getTotalLayers() const { return totalLayers; }
@@ -166,32 +220,85 @@ namespace mythril {
         uint32_t totalMips;
         uint32_t totalLayers;
 
-        std::vector<SubresourceEntry> subresourceStates;
+        // empty while uniform
+        SubresourceState uniformState{};
+        std::vector<SubresourceState> subresourceStates;
 
-        static SubresourceRange intersect(const SubresourceRange& a, const SubresourceRange& b) {
-            const uint32_t mipBegin = std::max(a.baseMip, b.baseMip);
-            const uint32_t mipEnd = std::min(a.baseMip + a.numMips, b.baseMip + b.numMips);
-            const uint32_t layerBegin = std::max(a.baseLayer, b.baseLayer);
-            const uint32_t layerEnd = std::min(a.baseLayer + a.numLayers, b.baseLayer + b.numLayers);
+        bool isUniform() const { return subresourceStates.empty(); }
+        size_t index(uint32_t mip, uint32_t layer) const { return static_cast<size_t>(mip) * totalLayers + layer; }
+        const SubresourceState& at(uint32_t mip, uint32_t layer) const { return subresourceStates[index(mip, layer)]; }
+        SubresourceRange clamp(const SubresourceRange& range) const {
+            const uint32_t mipBegin = std::min(range.baseMip, totalMips);
+            const uint32_t mipEnd = std::min(range.baseMip + range.numMips, totalMips);
+            const uint32_t layerBegin = std::min(range.baseLayer, totalLayers);
+            const uint32_t layerEnd = std::min(range.baseLayer + range.numLayers, totalLayers);
             return {mipBegin, mipEnd - mipBegin, layerBegin, layerEnd - layerBegin};
         }
-        static void appendIfValid(std::vector<SubresourceEntry>& entries, const SubresourceRange& range, const SubresourceState& state) {
-            if (range.numMips > 0 && range.numLayers > 0) {
-                entries.push_back({range, state});
+    };
+
+    // byte intervals of a buffer with the last access to each, sorted and always covering [0, VK_WHOLE_SIZE)
+    // neighbours with equal state are merged, so a buffer only ever touched as a whole stays a single interval
+    class BufferStateTracker {
+    public:
+        struct Interval {
+            VkDeviceSize begin;
+            VkDeviceSize end;
+            StageAccess state;
+        };
+        BufferStateTracker() : intervals{{0, VK_WHOLE_SIZE, {}}} {}
+
+        // clipped to [begin, end)
+        template<typename Alloc = std::allocator<Interval>>
+        std::vector<Interval, Alloc> getOverlappingStates(VkDeviceSize begin, VkDeviceSize end, const Alloc& alloc = Alloc()) const {
+            std::vector<Interval, Alloc> overlappingStates(alloc);
+            for (const Interval& interval: intervals) {
+                if (interval.end <= begin || interval.begin >= end)
+                    continue;
+                overlappingStates.push_back({std::max(interval.begin, begin), std::min(interval.end, end), interval.state});
             }
+            return overlappingStates;
         }
-        static void appendDifference(std::vector<SubresourceEntry>& entries, const SubresourceEntry& entry, const SubresourceRange& removedRange) {
-            const SubresourceRange overlap = intersect(entry.range, removedRange);
-            const uint32_t entryMipEnd = entry.range.baseMip + entry.range.numMips;
-            const uint32_t overlapMipEnd = overlap.baseMip + overlap.numMips;
-            const uint32_t entryLayerEnd = entry.range.baseLayer + entry.range.numLayers;
-            const uint32_t overlapLayerEnd = overlap.baseLayer + overlap.numLayers;
-
-            appendIfValid(entries, {entry.range.baseMip, overlap.baseMip - entry.range.baseMip, entry.range.baseLayer, entry.range.numLayers}, entry.state);
-            appendIfValid(entries, {overlapMipEnd, entryMipEnd - overlapMipEnd, entry.range.baseLayer, entry.range.numLayers}, entry.state);
-            appendIfValid(entries, {overlap.baseMip, overlap.numMips, entry.range.baseLayer, overlap.baseLayer - entry.range.baseLayer}, entry.state);
-            appendIfValid(entries, {overlap.baseMip, overlap.numMips, overlapLayerEnd, entryLayerEnd - overlapLayerEnd}, entry.state);
+        void setState(VkDeviceSize begin, VkDeviceSize end, StageAccess state) {
+            if (begin >= end)
+                return;
+            // built into the spare vector and swapped, so a warm tracker stops allocating
+            std::vector<Interval>& result = scratch;
+            result.clear();
+            result.reserve(intervals.size() + 2);
+            auto push = [&result](const Interval& interval) {
+                if (interval.begin >= interval.end)
+                    return;
+                if (!result.empty() && result.back().end == interval.begin && IsSameState(result.back().state, interval.state))
+                    result.back().end = interval.end;
+                else
+                    result.push_back(interval);
+            };
+            bool inserted = false;
+            for (const Interval& interval: intervals) {
+                if (interval.end <= begin || interval.begin >= end) {
+                    if (!inserted && interval.begin >= end) {
+                        push({begin, end, state});
+                        inserted = true;
+                    }
+                    push(interval);
+                    continue;
+                }
+                // keep whatever sticks out on either side
+                push({interval.begin, begin, interval.state});
+                if (!inserted) {
+                    push({begin, end, state});
+                    inserted = true;
+                }
+                push({end, interval.end, interval.state});
+            }
+            std::swap(intervals, scratch);
         }
+        void setState(StageAccess state) { intervals = {{0, VK_WHOLE_SIZE, state}}; }
+
+    private:
+        static bool IsSameState(const StageAccess& a, const StageAccess& b) { return a.stage == b.stage && a.access == b.access; }
+        std::vector<Interval> intervals;
+        std::vector<Interval> scratch;
     };
 
     struct CompiledImageBarrier {
@@ -206,6 +313,55 @@ namespace mythril {
     struct CompiledBufferBarrier {
         BufferHandle handle;
         StageAccess dstMask{};
+        // byte range the pass touches, end is VK_WHOLE_SIZE for everything past offset
+        VkDeviceSize offset = 0;
+        VkDeviceSize end = VK_WHOLE_SIZE;
+    };
+
+    // a pass' barriers for the steady state frame, simulated at compile so execute can record them as is
+    struct BakedBarrierBatch {
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+        // indices into imageBarriers that target the swapchain, image and old layout are patched every frame
+        std::vector<uint32_t> swapchainBarriers;
+        struct LayoutUpdate {
+            TextureHandle handle;
+            VkImageLayout layout;
+            bool isSwapchain;
+        };
+        // keeps AllocatedTexture::_vkCurrentImageLayout in step without touching the trackers
+        std::vector<LayoutUpdate> layouts;
+        // points into the vectors above, they are never resized after baking
+        VkDependencyInfo dependencyInfo{};
+        // split barriers this pass waits on before its own batch, as indices into RenderGraph::_splitBarriers
+        // and as parallel arrays for a single vkCmdWaitEvents2
+        std::vector<uint32_t> waitSplits;
+        std::vector<VkEvent> waitEvents;
+        std::vector<VkDependencyInfo> waitInfos;
+        // indices into RenderGraph::_splitBarriers, signaled once this pass is recorded
+        std::vector<uint32_t> signalSplits;
+    };
+
+    // a barrier whose producer sits at least one unrelated pass before its consumer
+    // the producer sets the event and the consumer waits on it, so the passes in between can overlap the transition
+    struct SplitBarrier {
+        VkEvent event = VK_NULL_HANDLE;
+        uint32_t producer = 0;
+        uint32_t consumer = 0;
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+        // set and wait have to be given the exact same dependency info
+        VkDependencyInfo dependencyInfo{};
+        // stages the consumer waits in, the event is reset behind them
+        VkPipelineStageFlags2 dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+    };
+
+    // rolling window behind a PassTiming
+    struct PassTimingHistory {
+        static constexpr uint32_t kNumSamples = 64;
+        std::array<float, kNumSamples> samples{};
+        uint32_t head = 0;
+        uint32_t count = 0;
     };
 
     struct UploadData {
@@ -213,6 +369,15 @@ namespace mythril {
         size_t size = 0;
     };
 
+    // attachment formats of a pass, which is all a pipeline built inside of it has to agree with
+    // packed at compile so pipeline resolves and secondaries never walk the attachments
+    struct AttachmentFormats {
+        static constexpr uint32_t kMaxColorFormats = 16;
+        std::array<VkFormat, kMaxColorFormats> colorFormats{};
+        uint32_t numColorFormats = 0;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    };
+
     // hidden information that transforms the PassSource into usable info
     struct CompiledPass {
         // transferred info from source
@@ -223,15 +388,59 @@ namespace mythril {
         std::vector<CompiledImageBarrier> imageBarriers;
         std::vector<CompiledBufferBarrier> bufferBarriers;
         std::function<void(CommandBuffer&)> executeCallback;
+        std::function<void(CommandBuffer&, uint32_t)> parallelCallback;
+        uint32_t chunkCount = 0;
+        bool isStatic = false;
         std::function<bool()> conditionCallback;
 
         // new info transformed from source on compile()
         std::vector<AttachmentInfo> colorAttachments;
         std::optional<AttachmentInfo> depthAttachment;
+        AttachmentFormats formats;
         VkRect2D renderArea;
+        // images the attachment infos were resolved against, in attachment order with resolves right after their attachment
+        // a resize swaps these out which is how refreshResources finds the passes it has to redo
+        std::vector<VkImage> attachmentImages;
+        // secondaries have to know this up front, it is otherwise only implied by the attachments
+        VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
         uint32_t layerCount = 1;
         uint32_t viewMask = 0;
+        // transients this pass uses the second version of, swapped into their Texture while the callbacks run
+        std::vector<uint32_t> versionedTransients;
     	QueueAffinity queue = QueueAffinity::Graphics;
+        // swapchain work has to stay on graphics and wait on the acquire semaphore
+        bool usesSwapchain = false;
+    };
+
+    // a pipeline the dry run bound before it was built, compile builds all of them at once afterwards
+    // handles because a callback creating pipelines may grow the pools while the dry run is going
+    struct PendingPipelineBuild {
+        GraphicsPipelineHandle graphics;
+        ComputePipelineHandle compute;
+        uint32_t viewMask = 0;
+        const CompiledPass* pass = nullptr;
+    };
+
+    // queue family ownership transfer planned during compile
+    // only the owner change is known then, the exact barriers come from the trackers at execute
+    struct QueueOwnershipTransfer {
+        // exactly one of these is valid
+        TextureHandle texture;
+        BufferHandle buffer;
+        QueueAffinity srcQueue = QueueAffinity::Graphics;
+        QueueAffinity dstQueue = QueueAffinity::Graphics;
+        // first access of the new owner, what the acquire makes the resource visible to
+        StageAccess dstMask{};
+    };
+
+    // everything that must happen at a layer boundary before that layer gets recorded
+    // boundary i sits before layer i, the extra last boundary is the end of the frame
+    struct CrossQueueSync {
+        // waits[consumer][producer], consumer waits on the producers timeline before recording
+        std::array<std::array<bool, kQueueCount>, kQueueCount> waits{};
+        // producers that must submit (and so signal their timeline) at this boundary
+        std::array<bool, kQueueCount> signals{};
+        std::vector<QueueOwnershipTransfer> transfers;
     };
 
 } // namespace mythril
@@ -3,13 +3,18 @@
 //
 
 #include "StagingDevice.h"
+#include "Logger.h"
 #include "mythril/CTX.h"
 #include "vkutil.h"
 
+#include <algorithm>
+
 
 namespace mythril {
-	StagingDevice::StagingDevice(CTX& ctx) :
-	    _ctx(ctx) {
+	StagingDevice::StagingDevice(CTX& ctx, ImmediateCommands& queue, uint32_t releaseFamily) :
+	    _ctx(ctx),
+	    _queue(queue),
+	    _releaseFamily(releaseFamily) {
 		const VkPhysicalDeviceLimits& limits = _ctx.getPhysicalDeviceProperties10().limits;
 		// use default value of 128Mb clamped to the max limits
 		_maxBufferSize = std::min(limits.maxStorageBufferRange, 128u * 1024u * 1024u);
@@ -20,15 +25,14 @@ namespace mythril {
 			buffer.bufferSubData(_ctx, dstOffset, size, data);
 			return;
 		}
-		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
-		ASSERT(stagingBuffer);
-
 		while (size) {
 			// get next staging buffer free offset
-			MemoryRegionDesc desc = getNextFreeOffset((uint32_t) size);
+			const MemoryRegionDesc desc = getNextFreeOffset((uint32_t) size);
 			const uint32_t chunkSize = std::min((uint32_t) size, desc.size_);
 
-			// copy data into staging buffer
+			// copy data into staging buffer, fetched after the offset as getting one may have grown the buffer
+			AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
+			ASSERT(stagingBuffer);
 			stagingBuffer->bufferSubData(_ctx, desc.offset_, chunkSize, data);
 
 			// do the transfer
@@ -37,53 +41,14 @@ namespace mythril {
 			    .dstOffset = dstOffset,
 			    .size = chunkSize,
 			};
-
-			const ImmediateCommands::CommandBufferWrapper& wrapper = _ctx._immGraphics->acquire();
-			vkCmdCopyBuffer(wrapper._cmdBuf, stagingBuffer->_vkBuffer, buffer._vkBuffer, 1, &copy);
-			VkBufferMemoryBarrier barrier = {
-			    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-			    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-			    .dstAccessMask = 0,
-			    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-			    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-			    .buffer = buffer._vkBuffer,
-			    .offset = dstOffset,
-			    .size = chunkSize,
-			};
-			VkPipelineStageFlags dstMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-			if (buffer._vkUsageFlags & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
-				dstMask |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
-				barrier.dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-			}
-			if (buffer._vkUsageFlags & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
-				dstMask |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
-				barrier.dstAccessMask |= VK_ACCESS_INDEX_READ_BIT;
-			}
-			if (buffer._vkUsageFlags & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
-				dstMask |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
-				barrier.dstAccessMask |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-			}
-			if (buffer._vkUsageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
-				barrier.dstAccessMask |= VK_ACCESS_UNIFORM_READ_BIT;
-			}
-			if (buffer._vkUsageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
-				barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-			}
-			if (buffer._vkUsageFlags & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR) {
-				dstMask |= VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
-				barrier.dstAccessMask |= VK_ACCESS_MEMORY_READ_BIT;
-			}
-			vkCmdPipelineBarrier(wrapper._cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, dstMask, VkDependencyFlags{}, 0, nullptr, 1, &barrier, 0, nullptr);
-			desc.handle_ = _ctx._immGraphics->submit(wrapper);
-			desc.state_ = MemoryRegionDesc::State::Busy;
-			_regions.push_back(desc);
+			uploadBuffer(buffer, desc, copy);
 
 			size -= chunkSize;
 			data = (uint8_t*) data + chunkSize;
 			dstOffset += chunkSize;
 		}
 	}
-	std::vector<StagingDevice::StagedBufferCopy> StagingDevice::stageBufferCopy(AllocatedBuffer& buffer, const void* data, size_t size, size_t dstOffset) {
+	ArenaVector<StagingDevice::StagedBufferCopy> StagingDevice::stageBufferCopy(AllocatedBuffer& buffer, const void* data, size_t size, size_t dstOffset) {
 		ASSERT_MSG(data, "StagingDevice::stageBufferCopy called with null data.");
 		ASSERT_MSG(size > 0, "StagingDevice::stageBufferCopy size must be greater than 0.");
 		ASSERT_MSG(dstOffset + size <= buffer._bufferSize, "StagingDevice::stageBufferCopy: offset + size exceeds buffer '{}' size.", buffer._debugName);
@@ -94,19 +59,10 @@ namespace mythril {
 		ensureStagingBufferSize(requestedAlignedSize);
 		ASSERT_MSG(requestedAlignedSize <= _stagingBufferSize, "StagingDevice::stageBufferCopy upload is larger than the staging buffer maximum.");
 
-		uint32_t totalFree = 0;
-		for (const MemoryRegionDesc& region: _regions) {
-			if (isRegionFree(region))
-				totalFree += region.size_;
-		}
-		if (totalFree < requestedAlignedSize) {
-			waitAndReset();
-		}
-
 		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
 		ASSERT(stagingBuffer);
 
-		std::vector<StagedBufferCopy> copies;
+		ArenaVector<StagedBufferCopy> copies{ArenaAllocator<StagedBufferCopy>(_ctx.getFrameArenaImpl())};
 		while (size) {
 			MemoryRegionDesc desc = getNextFreeOffset(static_cast<uint32_t>(size));
 			ASSERT_MSG(desc.size_ > 0, "StagingDevice::stageBufferCopy could not allocate a staging region.");
@@ -116,10 +72,9 @@ namespace mythril {
 
 			copies.push_back({.stagingOffset = desc.offset_, .size = chunkSize, .dstBuffer = buffer._vkBuffer, .dstOffset = dstOffset});
 
-			desc.size_ = chunkSize;
 			desc.state_ = MemoryRegionDesc::State::Pending;
 			desc.handle_ = {};
-			_regions.push_back(desc);
+			commitRegion(desc);
 
 			size -= chunkSize;
 			data = static_cast<const uint8_t*>(data) + chunkSize;
@@ -134,7 +89,7 @@ namespace mythril {
 		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
 		ASSERT(stagingBuffer);
 
-		std::vector<VkBufferCopy> regions;
+		ArenaVector<VkBufferCopy> regions{ArenaAllocator<VkBufferCopy>(_ctx.getFrameArenaImpl())};
 		regions.reserve(copies.size());
 		VkBuffer dstBuffer = copies.front().dstBuffer;
 		for (const StagedBufferCopy& copy: copies) {
@@ -152,88 +107,315 @@ namespace mythril {
 
 	void StagingDevice::onGraphSubmit(SubmitHandle submit) {
 		ASSERT_MSG(!submit.empty(), "StagingDevice::onGraphSubmit requires a valid submit handle.");
-		for (MemoryRegionDesc& region: _regions) {
-			if (region.state_ != MemoryRegionDesc::State::Pending)
+		for (size_t i = _firstFence; i < _fences.size(); ++i) {
+			RingFence& fence = _fences[i];
+			if (fence.state_ != MemoryRegionDesc::State::Pending)
 				continue;
-			region.handle_ = submit;
-			region.state_ = MemoryRegionDesc::State::Busy;
+			fence.handle_ = submit;
+			fence.state_ = MemoryRegionDesc::State::Busy;
+		}
+		for (PendingReadback& readback: _readbacks) {
+			if (!readback.awaitingSubmit_)
+				continue;
+			readback.handle_ = submit;
+			readback.awaitingSubmit_ = false;
 		}
 	}
 
 	void StagingDevice::resetPending() {
-		for (MemoryRegionDesc& region: _regions) {
-			if (region.state_ != MemoryRegionDesc::State::Pending)
+		// the ring only retires from the front, these go once everything before them did
+		for (size_t i = _firstFence; i < _fences.size(); ++i) {
+			RingFence& fence = _fences[i];
+			if (fence.state_ != MemoryRegionDesc::State::Pending)
 				continue;
-			region.handle_ = {};
-			region.state_ = MemoryRegionDesc::State::Free;
+			fence.handle_ = {};
+			fence.state_ = MemoryRegionDesc::State::Free;
+		}
+		// readbacks of an abandoned command buffer never get their copy
+		for (size_t i = 0; i < _readbacks.size();) {
+			if (_readbacks[i].awaitingSubmit_)
+				releaseReadback(_readbacks[i].id_);
+			else
+				i++;
 		}
 	}
-	void StagingDevice::imageData3D(AllocatedTexture& image, const VkOffset3D& offset, const VkExtent3D& extent, VkFormat format, const void* data) {
-		ASSERT_MSG(image._numLevels == 1, "Can handle only 3D images with exactly 1 mip-level");
-		ASSERT_MSG((offset.x == 0) && (offset.y == 0) && (offset.z == 0), "Can upload only full-size 3D images");
-		const uint32_t storageSize = extent.width * extent.height * extent.depth * vkutil::GetBytesPerPixel(format);
 
-		ensureStagingBufferSize(storageSize);
-
-		ASSERT_MSG(storageSize <= _stagingBufferSize, "No support for copying image in multiple smaller chunk sizes");
-
-		// get next staging buffer free offset
-		MemoryRegionDesc desc = getNextFreeOffset(storageSize);
-
-		// No support for copying image in multiple smaller chunk sizes.
-		// If we get smaller buffer size than storageSize, we will wait for GPU idle and get a bigger chunk.
-		if (desc.size_ < storageSize) {
-			waitAndReset();
-			desc = getNextFreeOffset(storageSize);
+	void StagingDevice::beginBatch() {
+		ASSERT_MSG(!_isBatching, "An upload batch is already open, flush it before beginning another one!");
+		_isBatching = true;
+		_batchSubmit = {};
+	}
+	SubmitHandle StagingDevice::submitBatch() {
+		ASSERT_MSG(_isBatching, "StagingDevice::submitBatch called without an open upload batch.");
+		if (_batchedBuffers.empty() && _batchedImages.empty())
+			return _batchSubmit;
+
+		_batchSubmit = submitUploads(_batchedBuffers, _batchedImages);
+		for (size_t i = _firstFence; i < _fences.size(); ++i) {
+			RingFence& fence = _fences[i];
+			if (fence.state_ != MemoryRegionDesc::State::Batched)
+				continue;
+			fence.handle_ = _batchSubmit;
+			fence.state_ = MemoryRegionDesc::State::Busy;
 		}
+		_batchedBuffers.clear();
+		_batchedBufferIndices.clear();
+		_batchedImages.clear();
+		return _batchSubmit;
+	}
+	SubmitHandle StagingDevice::endBatch() {
+		ASSERT_MSG(_isBatching, "StagingDevice::endBatch called without an open upload batch.");
+		// submits are chained on the queue, so the last one of the batch stands for all of them
+		const SubmitHandle handle = submitBatch();
+		_isBatching = false;
+		_batchSubmit = {};
+		return handle;
+	}
 
-		ASSERT(desc.size_ >= storageSize);
+	// sync2 twin of what the old per upload barrier derived from the usage flags
+	static StageAccess GetBufferUploadStageAccess(VkBufferUsageFlags usage) {
+		StageAccess dst = {.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_NONE};
+		if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+			dst.stage |= VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+			dst.access |= VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+		}
+		if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+			dst.stage |= VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
+			dst.access |= VK_ACCESS_2_INDEX_READ_BIT;
+		}
+		if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+			dst.stage |= VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
+			dst.access |= VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+		}
+		if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+			dst.access |= VK_ACCESS_2_UNIFORM_READ_BIT;
+		}
+		if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+			dst.access |= VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+		}
+		if (usage & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR) {
+			dst.stage |= VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+			dst.access |= VK_ACCESS_2_MEMORY_READ_BIT;
+		}
+		return dst;
+	}
+	static bool SubresourceRangesOverlap(const VkImageSubresourceRange& a, const VkImageSubresourceRange& b) {
+		const bool mipsOverlap = a.baseMipLevel < b.baseMipLevel + b.levelCount && b.baseMipLevel < a.baseMipLevel + a.levelCount;
+		const bool layersOverlap = a.baseArrayLayer < b.baseArrayLayer + b.layerCount && b.baseArrayLayer < a.baseArrayLayer + a.layerCount;
+		return mipsOverlap && layersOverlap;
+	}
 
+	void StagingDevice::recordUploads(VkCommandBuffer cmd, std::span<const BufferUpload> buffers, std::span<const ImageUpload> images, PendingAcquire* acquire) const {
 		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
+		ASSERT(stagingBuffer);
 
-		// 1. Copy the pixel data into the host visible staging buffer
-		stagingBuffer->bufferSubData(_ctx, desc.offset_, storageSize, data);
-
-		const ImmediateCommands::CommandBufferWrapper& wrapper = _ctx._immGraphics->acquire();
+		// 1. Transition every destination image into TRANSFER_DST_OPTIMAL at once
+		std::vector<VkImageMemoryBarrier2> imageBarriers;
+		imageBarriers.reserve(images.size());
+		for (const ImageUpload& upload: images) {
+			if (!upload.isFirst)
+				continue;
+			imageBarriers.push_back({
+			    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			    .srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+			    .srcAccessMask = VK_ACCESS_2_NONE,
+			    .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			    .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			    .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			    .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			    .image = upload.image,
+			    .subresourceRange = upload.range,
+			});
+		}
+		if (!imageBarriers.empty()) {
+			const VkDependencyInfo dependencyInfo = {
+			    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			    .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+			    .pImageMemoryBarriers = imageBarriers.data(),
+			};
+			vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+		}
 
-		// 1. Transition initial image layout into TRANSFER_DST_OPTIMAL
-		vkutil::ImageMemoryBarrier2(
-		        wrapper._cmdBuf,
-		        image._vkImage,
-		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, .access = VK_ACCESS_2_NONE},
-		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .access = VK_ACCESS_2_TRANSFER_WRITE_BIT},
-		        VK_IMAGE_LAYOUT_UNDEFINED,
-		        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		        VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}
-		);
+		// 2. One copy call per destination
+		for (const BufferUpload& upload: buffers) {
+			vkCmdCopyBuffer(cmd, stagingBuffer->_vkBuffer, upload.buffer, static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+		}
+		for (const ImageUpload& upload: images) {
+			vkCmdCopyBufferToImage(
+			        cmd, stagingBuffer->_vkBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(upload.regions.size()), upload.regions.data()
+			);
+		}
 
-		// 2. Copy the pixel data from the staging buffer into the image
-		const VkBufferImageCopy copy = {
-		    .bufferOffset = desc.offset_,
-		    .bufferRowLength = 0,
-		    .bufferImageHeight = 0,
-		    .imageSubresource = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
-		    .imageOffset = offset,
-		    .imageExtent = extent,
+		// 3. Make the copies visible to their consumers and move the images into SHADER_READ_ONLY_OPTIMAL, again all at once
+		// when releasing to another family the consumer half of each barrier is held back for its acquire
+		const uint32_t srcFamily = acquire ? _queue.getQueueFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+		const uint32_t dstFamily = acquire ? _releaseFamily : VK_QUEUE_FAMILY_IGNORED;
+		std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+		bufferBarriers.reserve(buffers.size());
+		for (const BufferUpload& upload: buffers) {
+			const StageAccess dst = GetBufferUploadStageAccess(upload.usage);
+			VkBufferMemoryBarrier2 barrier = {
+			    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			    .dstStageMask = dst.stage,
+			    .dstAccessMask = dst.access,
+			    .srcQueueFamilyIndex = srcFamily,
+			    .dstQueueFamilyIndex = dstFamily,
+			    .buffer = upload.buffer,
+			    .offset = upload.begin,
+			    .size = upload.end - upload.begin,
+			};
+			if (acquire) {
+				acquire->buffers.push_back(barrier);
+				acquire->buffers.back().srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+				acquire->buffers.back().srcAccessMask = VK_ACCESS_2_NONE;
+				barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+				barrier.dstAccessMask = VK_ACCESS_2_NONE;
+			}
+			bufferBarriers.push_back(barrier);
+		}
+		imageBarriers.clear();
+		for (const ImageUpload& upload: images) {
+			if (!upload.isLast)
+				continue;
+			VkImageMemoryBarrier2 barrier = {
+			    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			    .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			    .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+			    .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			    .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			    .srcQueueFamilyIndex = srcFamily,
+			    .dstQueueFamilyIndex = dstFamily,
+			    .image = upload.image,
+			    .subresourceRange = upload.range,
+			};
+			if (acquire) {
+				// the layout transition is part of both halves
+				acquire->images.push_back(barrier);
+				acquire->images.back().srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+				acquire->images.back().srcAccessMask = VK_ACCESS_2_NONE;
+				barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+				barrier.dstAccessMask = VK_ACCESS_2_NONE;
+			}
+			imageBarriers.push_back(barrier);
+		}
+		// a chunk in the middle of a streamed image has nothing to hand over yet
+		if (bufferBarriers.empty() && imageBarriers.empty())
+			return;
+		const VkDependencyInfo dependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+		    .pBufferMemoryBarriers = bufferBarriers.data(),
+		    .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+		    .pImageMemoryBarriers = imageBarriers.data(),
 		};
-		vkCmdCopyBufferToImage(wrapper._cmdBuf, stagingBuffer->_vkBuffer, image._vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-		// 3. Transition TRANSFER_DST_OPTIMAL into SHADER_READ_ONLY_OPTIMAL
-		vkutil::ImageMemoryBarrier2(
-		        wrapper._cmdBuf,
-		        image._vkImage,
-		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .access = VK_ACCESS_2_TRANSFER_WRITE_BIT},
-		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT},
-		        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		        VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}
-		);
+		vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+	}
+	SubmitHandle StagingDevice::submitUploads(std::span<const BufferUpload> buffers, std::span<const ImageUpload> images) {
+		const ImmediateCommands::CommandBufferWrapper& wrapper = _queue.acquire();
+		PendingAcquire acquire;
+		recordUploads(wrapper._cmdBuf, buffers, images, _releaseFamily != VK_QUEUE_FAMILY_IGNORED ? &acquire : nullptr);
+		const SubmitHandle handle = _queue.submit(wrapper);
+		if (!acquire.buffers.empty() || !acquire.images.empty()) {
+			acquire.value = _queue.getLastTimelineValue();
+			_pendingAcquires.push_back(std::move(acquire));
+		}
+		return handle;
+	}
+	uint64_t StagingDevice::recordAcquires(VkCommandBuffer cmd, uint64_t upToValue) {
+		// one queue signals its timeline in submit order, so the pending acquires are sorted by value
+		size_t numReady = 0;
+		while (numReady < _pendingAcquires.size() && _pendingAcquires[numReady].value <= upToValue)
+			numReady++;
+		if (numReady == 0)
+			return 0;
+
+		std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+		std::vector<VkImageMemoryBarrier2> imageBarriers;
+		for (size_t i = 0; i < numReady; ++i) {
+			const PendingAcquire& acquire = _pendingAcquires[i];
+			bufferBarriers.insert(bufferBarriers.end(), acquire.buffers.begin(), acquire.buffers.end());
+			imageBarriers.insert(imageBarriers.end(), acquire.images.begin(), acquire.images.end());
+		}
+		const VkDependencyInfo dependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+		    .pBufferMemoryBarriers = bufferBarriers.data(),
+		    .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+		    .pImageMemoryBarriers = imageBarriers.data(),
+		};
+		vkCmdPipelineBarrier2(cmd, &dependencyInfo);
 
+		const uint64_t value = _pendingAcquires[numReady - 1].value;
+		_pendingAcquires.erase(_pendingAcquires.begin(), _pendingAcquires.begin() + static_cast<std::ptrdiff_t>(numReady));
+		return value;
+	}
+	void StagingDevice::uploadBuffer(AllocatedBuffer& buffer, MemoryRegionDesc region, const VkBufferCopy& copy) {
+		if (_isBatching) {
+			auto it = _batchedBufferIndices.find(buffer._vkBuffer);
+			// overlapping destinations within one copy call have no defined order, those go into the next submit
+			if (it != _batchedBufferIndices.end()) {
+				const BufferUpload& batched = _batchedBuffers[it->second];
+				if (copy.dstOffset < batched.end && batched.begin < copy.dstOffset + copy.size) {
+					submitBatch();
+					it = _batchedBufferIndices.end();
+				}
+			}
+			if (it == _batchedBufferIndices.end()) {
+				it = _batchedBufferIndices.emplace(buffer._vkBuffer, static_cast<uint32_t>(_batchedBuffers.size())).first;
+				_batchedBuffers.push_back({.buffer = buffer._vkBuffer, .usage = buffer._vkUsageFlags, .begin = copy.dstOffset, .end = copy.dstOffset + copy.size});
+			}
+			BufferUpload& upload = _batchedBuffers[it->second];
+			upload.begin = std::min(upload.begin, copy.dstOffset);
+			upload.end = std::max(upload.end, copy.dstOffset + copy.size);
+			upload.regions.push_back(copy);
+			region.handle_ = {};
+			region.state_ = MemoryRegionDesc::State::Batched;
+		} else {
+			const BufferUpload upload = {.buffer = buffer._vkBuffer, .usage = buffer._vkUsageFlags, .begin = copy.dstOffset, .end = copy.dstOffset + copy.size, .regions = {copy}};
+			region.handle_ = submitUploads({&upload, 1}, {});
+			region.state_ = MemoryRegionDesc::State::Busy;
+		}
+		commitRegion(region);
+	}
+	void StagingDevice::uploadImage(AllocatedTexture& image, MemoryRegionDesc region, ImageUpload&& upload) {
+		// recorded state, true once the upload is submitted
 		image._vkCurrentImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		if (_isBatching) {
+			// a subresource that is already in the batch would be transitioned twice, so flush what we have first
+			for (const ImageUpload& batched: _batchedImages) {
+				if (batched.image == upload.image && SubresourceRangesOverlap(batched.range, upload.range)) {
+					submitBatch();
+					break;
+				}
+			}
+			_batchedImages.push_back(std::move(upload));
+			region.handle_ = {};
+			region.state_ = MemoryRegionDesc::State::Batched;
+		} else {
+			region.handle_ = submitUploads({}, {&upload, 1});
+			region.state_ = MemoryRegionDesc::State::Busy;
+		}
+		commitRegion(region);
+	}
+	void StagingDevice::imageData3D(AllocatedTexture& image, const VkOffset3D& offset, const VkExtent3D& extent, VkFormat format, const void* data) {
+		ASSERT_MSG(image._numLevels == 1, "Can handle only 3D images with exactly 1 mip-level");
+		ASSERT_MSG((offset.x == 0) && (offset.y == 0) && (offset.z == 0), "Can upload only full-size 3D images");
 
-		desc.handle_ = _ctx._immGraphics->submit(wrapper);
-		desc.state_ = MemoryRegionDesc::State::Busy;
-		_regions.push_back(desc);
+		const ImageBox box = {
+		    .subresource = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+		    .offset = offset,
+		    .extent = extent,
+		    .rowBytes = extent.width * vkutil::GetBytesPerPixel(format),
+		    .numRows = extent.height,
+		    .data = static_cast<const uint8_t*>(data),
+		};
+		streamImage(image, VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}, {&box, 1});
 	}
 	void StagingDevice::imageData2D(
 	        AllocatedTexture& image, const VkRect2D& imageRegion, uint32_t baseMipLevel, uint32_t numMipLevels, uint32_t layerCheck, uint32_t numLayers, VkFormat format, const void* data
@@ -241,8 +423,8 @@ namespace mythril {
 		ASSERT(numMipLevels <= kMaxMipLevels);
 
 		// divide the width and height by 2 until we get to the size of level 'baseMipLevel'
-		uint32_t width = image._vkExtent.width >> baseMipLevel;
-		uint32_t height = image._vkExtent.height >> baseMipLevel;
+		const uint32_t width = image._vkExtent.width >> baseMipLevel;
+		const uint32_t height = image._vkExtent.height >> baseMipLevel;
 
 		// not sure
 		ASSERT_MSG(
@@ -250,34 +432,6 @@ namespace mythril {
 		        "Uploading mip-levels with an image region that is smaller than the base mip level is not supported!"
 		);
 
-		// find the storage size for all mip-levels being uploaded
-		uint32_t layerStorageSize = 0;
-		for (uint32_t i = 0; i < numMipLevels; ++i) {
-			layerStorageSize += vkutil::GetTextureBytesPerLayer(image._vkExtent.width, image._vkExtent.height, format, i);
-			width = std::max(1u, width >> 1);
-			height = std::max(1u, height >> 1);
-			//			width = width <= 1 ? 1 : width >> 1;
-			//			height = height <= 1 ? 1 : height >> 1;
-		}
-		const uint32_t storageSize = layerStorageSize * numLayers;
-
-		ensureStagingBufferSize(storageSize);
-		ASSERT(storageSize <= _stagingBufferSize);
-		MemoryRegionDesc desc = getNextFreeOffset(storageSize);
-		// No support for copying image in multiple smaller chunk sizes. If we get smaller buffer size than storageSize, we will wait for GPU idle
-		// and get bigger chunk.
-		if (desc.size_ < storageSize) {
-			waitAndReset();
-			desc = getNextFreeOffset(storageSize);
-		}
-		ASSERT(desc.size_ >= storageSize);
-
-		const ImmediateCommands::CommandBufferWrapper& wrapper = _ctx._immGraphics->acquire();
-
-		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
-		stagingBuffer->bufferSubData(_ctx, desc.offset_, storageSize, data);
-
-		uint32_t offset = 0;
 		const uint32_t numPlanes = vkutil::GetNumImagePlanes(image._vkFormat);
 		if (numPlanes > 1) {
 			ASSERT(layerCheck == 0 && baseMipLevel == 0);
@@ -293,24 +447,18 @@ namespace mythril {
 		if (numPlanes == 3) {
 			imageAspect = VK_IMAGE_ASPECT_PLANE_0_BIT | VK_IMAGE_ASPECT_PLANE_1_BIT | VK_IMAGE_ASPECT_PLANE_2_BIT;
 		}
+		const uint32_t blockHeight = vkutil::GetTextureBlockHeight(format);
 
 		// https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+		// levels are packed one after the other, each holding all of its layers and each layer all of its planes
+		std::vector<ImageBox> boxes;
+		boxes.reserve(numMipLevels * numLayers * numPlanes);
+		const uint8_t* layerData = static_cast<const uint8_t*>(data);
 		for (uint32_t mipLevel = 0; mipLevel < numMipLevels; mipLevel++) {
 			for (uint32_t layer = 0; layer != numLayers; layer++) {
 				const uint32_t currentMipLevel = baseMipLevel + mipLevel;
+				const uint32_t layerSize = vkutil::GetTextureBytesPerLayer(imageRegion.extent.width, imageRegion.extent.height, format, mipLevel);
 
-				// 1. Transition initial image layout into TRANSFER_DST_OPTIMAL
-				vkutil::ImageMemoryBarrier2(
-				        wrapper._cmdBuf,
-				        image._vkImage,
-				        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, .access = VK_ACCESS_2_NONE},
-				        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .access = VK_ACCESS_2_TRANSFER_WRITE_BIT},
-				        VK_IMAGE_LAYOUT_UNDEFINED,
-				        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				        VkImageSubresourceRange{imageAspect, currentMipLevel, 1, layer, 1}
-				);
-
-				// 2. Copy the pixel data from the staging buffer into the image
 				uint32_t planeOffset = 0;
 				for (uint32_t plane = 0; plane != numPlanes; plane++) {
 					const VkExtent2D extent = vkutil::GetImagePlaneExtent(
@@ -321,46 +469,337 @@ namespace mythril {
 					        format,
 					        plane
 					);
-					const VkRect2D region = {
-					    .offset = {.x = imageRegion.offset.x >> mipLevel, .y = imageRegion.offset.y >> mipLevel},
-					    .extent = extent,
-					};
-					const VkBufferImageCopy copy = {
-					    // the offset for this level is at the start of all mip-levels plus the size of all previous mip-levels being uploaded
-					    .bufferOffset = desc.offset_ + offset + planeOffset,
-					    .bufferRowLength = 0,
-					    .bufferImageHeight = 0,
-					    .imageSubresource = VkImageSubresourceLayers{numPlanes > 1 ? VK_IMAGE_ASPECT_PLANE_0_BIT << plane : imageAspect, currentMipLevel, layer, 1},
-					    .imageOffset = {.x = region.offset.x, .y = region.offset.y, .z = 0},
-					    .imageExtent = {.width = region.extent.width, .height = region.extent.height, .depth = 1u},
-					};
-					vkCmdCopyBufferToImage(wrapper._cmdBuf, stagingBuffer->_vkBuffer, image._vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-					planeOffset += vkutil::GetTextureBytesPerPlane(imageRegion.extent.width, imageRegion.extent.height, format, plane);
+					const uint32_t planeSize = numPlanes > 1 ? vkutil::GetTextureBytesPerPlane(imageRegion.extent.width, imageRegion.extent.height, format, plane) : layerSize;
+					const uint32_t numRows = (extent.height + blockHeight - 1) / blockHeight;
+					boxes.push_back({
+					    .subresource = VkImageSubresourceLayers{numPlanes > 1 ? VK_IMAGE_ASPECT_PLANE_0_BIT << plane : imageAspect, currentMipLevel, layer, 1},
+					    .offset = {.x = imageRegion.offset.x >> mipLevel, .y = imageRegion.offset.y >> mipLevel, .z = 0},
+					    .extent = {.width = extent.width, .height = extent.height, .depth = 1u},
+					    .rowBytes = planeSize / numRows,
+					    .numRows = numRows,
+					    .blockHeight = blockHeight,
+					    .data = layerData + planeOffset,
+					});
+					planeOffset += planeSize;
 				}
-
-				// 3. Transition TRANSFER_DST_OPTIMAL into SHADER_READ_ONLY_OPTIMAL
-				vkutil::ImageMemoryBarrier2(
-				        wrapper._cmdBuf,
-				        image._vkImage,
-				        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .access = VK_ACCESS_2_TRANSFER_WRITE_BIT},
-				        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT},
-				        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				        VkImageSubresourceRange{imageAspect, currentMipLevel, 1, layer, 1}
-				);
-
-				offset += vkutil::GetTextureBytesPerLayer(imageRegion.extent.width, imageRegion.extent.height, format, currentMipLevel);
+				layerData += layerSize;
 			}
 		}
-		image._vkCurrentImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		streamImage(image, VkImageSubresourceRange{imageAspect, baseMipLevel, numMipLevels, 0, numLayers}, boxes);
+	}
+	void StagingDevice::streamImage(AllocatedTexture& image, const VkImageSubresourceRange& range, std::span<const ImageBox> boxes) {
+		uint64_t remainingBytes = 0;
+		for (const ImageBox& box: boxes)
+			remainingBytes += static_cast<uint64_t>(box.rowBytes) * box.numRows * box.extent.depth;
+
+		ensureStagingBufferSize(static_cast<uint32_t>(std::min<uint64_t>(remainingBytes, _maxBufferSize)));
+		// anything larger than the ring goes in pieces of a fraction of it, one filled while the ones before it are copied
+		const uint32_t maxChunkSize = remainingBytes > _stagingBufferSize ? _stagingBufferSize / kNumStreamingChunks : _stagingBufferSize;
+
+		ImageUpload upload = {.image = image._vkImage, .range = range};
+		size_t boxIdx = 0;
+		// progress within boxes[boxIdx]
+		uint32_t slice = 0;
+		uint32_t row = 0;
+		while (boxIdx < boxes.size()) {
+			// every copy starts 16 byte aligned, which covers both the texel block and the transfer queue offset rules
+			const uint64_t wantedSize = remainingBytes + (boxes.size() - boxIdx) * kStagingBufferAlignment;
+			const MemoryRegionDesc region = getNextFreeOffset(static_cast<uint32_t>(std::min<uint64_t>(wantedSize, maxChunkSize)));
+			AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
+			ASSERT(stagingBuffer);
+
+			uint32_t used = 0;
+			while (boxIdx < boxes.size()) {
+				const ImageBox& box = boxes[boxIdx];
+				ASSERT_MSG(box.rowBytes <= maxChunkSize, "A single texel row is larger than the staging buffer!");
+				const uint32_t copyOffset = vkutil::GetAlignedSize(used, kStagingBufferAlignment);
+				if (copyOffset >= region.size_)
+					break;
+				const uint32_t space = region.size_ - copyOffset;
+				const uint64_t sliceBytes = static_cast<uint64_t>(box.rowBytes) * box.numRows;
+				const uint8_t* src = box.data + slice * sliceBytes + static_cast<uint64_t>(row) * box.rowBytes;
+				const VkOffset3D imageOffset = {
+				    .x = box.offset.x,
+				    .y = box.offset.y + static_cast<int32_t>(row * box.blockHeight),
+				    .z = box.offset.z + static_cast<int32_t>(slice),
+				};
+				VkExtent3D imageExtent;
+				uint32_t numBytes;
+				if (row == 0 && space >= sliceBytes) {
+					const uint32_t numSlices = std::min(static_cast<uint32_t>(space / sliceBytes), box.extent.depth - slice);
+					imageExtent = {.width = box.extent.width, .height = box.extent.height, .depth = numSlices};
+					numBytes = static_cast<uint32_t>(numSlices * sliceBytes);
+					slice += numSlices;
+				} else {
+					// not even one slice fits, go row by row
+					const uint32_t numRows = std::min(space / box.rowBytes, box.numRows - row);
+					if (numRows == 0)
+						break;
+					imageExtent = {.width = box.extent.width, .height = std::min(numRows * box.blockHeight, box.extent.height - row * box.blockHeight), .depth = 1u};
+					numBytes = numRows * box.rowBytes;
+					row += numRows;
+					if (row == box.numRows) {
+						row = 0;
+						slice++;
+					}
+				}
+				stagingBuffer->bufferSubData(_ctx, region.offset_ + copyOffset, numBytes, src);
+				upload.regions.push_back({
+				    .bufferOffset = region.offset_ + copyOffset,
+				    .bufferRowLength = 0,
+				    .bufferImageHeight = 0,
+				    .imageSubresource = box.subresource,
+				    .imageOffset = imageOffset,
+				    .imageExtent = imageExtent,
+				});
+				used = copyOffset + numBytes;
+				remainingBytes -= numBytes;
+				if (slice == box.extent.depth) {
+					boxIdx++;
+					slice = 0;
+				}
+			}
+			if (upload.regions.empty()) {
+				// what was left at the end of the ring doesnt hold a single row, hand it back and start over at the front
+				commitRegion(region);
+				continue;
+			}
+			upload.isLast = boxIdx == boxes.size();
+			uploadImage(image, region, std::move(upload));
+			upload = {.image = image._vkImage, .range = range, .isFirst = false};
+		}
+	}
+	uint32_t StagingDevice::requestBufferReadback(VkCommandBuffer cmd, AllocatedBuffer& buffer, size_t offset, size_t size, ReadbackCallback&& callback) {
+		ASSERT_MSG(size <= UINT32_MAX, "StagingDevice::requestBufferReadback size exceeds the staging allocator's uint32 range.");
+		const MemoryRegionDesc region = getReadbackRegion(static_cast<uint32_t>(size));
+		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
+		ASSERT(stagingBuffer);
 
-		desc.handle_ = _ctx._immGraphics->submit(wrapper);
-		desc.state_ = MemoryRegionDesc::State::Busy;
-		_regions.push_back(desc);
+		const ImmediateCommands::CommandBufferWrapper* wrapper = cmd ? nullptr : &_queue.acquire();
+		if (wrapper)
+			cmd = wrapper->_cmdBuf;
+
+		// 1. Wait for whatever wrote the buffer before
+		const VkBufferMemoryBarrier2 barrier = {
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		    .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		    .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+		    .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		    .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+		    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .buffer = buffer._vkBuffer,
+		    .offset = offset,
+		    .size = size,
+		};
+		const VkDependencyInfo dependencyInfo = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &barrier};
+		vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+		// 2. Copy into the readback region
+		const VkBufferCopy copy = {
+		    .srcOffset = offset,
+		    .dstOffset = region.offset_,
+		    .size = size,
+		};
+		vkCmdCopyBuffer(cmd, buffer._vkBuffer, stagingBuffer->_vkBuffer, 1, &copy);
+
+		// 3. Hold back whatever writes the buffer next until the copy has read it
+		// the graph's trackers never see this read, so a later write's barrier would not cover TRANSFER
+		const VkBufferMemoryBarrier2 postBarrier = {
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		    .srcAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+		    .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		    .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+		    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .buffer = buffer._vkBuffer,
+		    .offset = offset,
+		    .size = size,
+		};
+		const VkDependencyInfo postDependencyInfo = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &postBarrier};
+		vkCmdPipelineBarrier2(cmd, &postDependencyInfo);
+
+		return submitReadback(cmd, wrapper, region, static_cast<uint32_t>(size), std::move(callback));
+	}
+	uint32_t StagingDevice::requestImageReadback(
+	        VkCommandBuffer cmd, AllocatedTexture& image, const VkOffset3D& offset, const VkExtent3D& extent, VkImageSubresourceRange range, VkFormat format, ReadbackCallback&& callback
+	) {
+		ASSERT(image.getImageLayout() != VK_IMAGE_LAYOUT_UNDEFINED);
+		ASSERT(range.layerCount == 1);
+		// only baseMipLevel is copied and sized, the barriers must not cover more than that
+		ASSERT(range.levelCount == 1);
+		const uint32_t storageSize = extent.width * extent.height * extent.depth * vkutil::GetBytesPerPixel(format);
+		const MemoryRegionDesc region = getReadbackRegion(storageSize);
+		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
+		ASSERT(stagingBuffer);
+
+		const ImmediateCommands::CommandBufferWrapper* wrapper = cmd ? nullptr : &_queue.acquire();
+		if (wrapper)
+			cmd = wrapper->_cmdBuf;
+
+		// 1. Transition to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		vkutil::ImageMemoryBarrier2(
+		        cmd,
+		        image._vkImage,
+		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_MEMORY_WRITE_BIT},
+		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .access = VK_ACCESS_2_TRANSFER_READ_BIT},
+		        image.getImageLayout(),
+		        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		        range
+		);
+
+		// 2. Copy the pixel data from the image into the readback region
+		const VkBufferImageCopy copy = {
+		    .bufferOffset = region.offset_,
+		    .bufferRowLength = 0,
+		    .bufferImageHeight = extent.height,
+		    .imageSubresource =
+		            VkImageSubresourceLayers{
+		                .aspectMask = range.aspectMask,
+		                .mipLevel = range.baseMipLevel,
+		                .baseArrayLayer = range.baseArrayLayer,
+		                .layerCount = range.layerCount,
+		            },
+		    .imageOffset = offset,
+		    .imageExtent = extent,
+		};
+		vkCmdCopyImageToBuffer(cmd, image._vkImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer->_vkBuffer, 1, &copy);
+
+		// 3. Transition back to the layout the image was in
+		vkutil::ImageMemoryBarrier2(
+		        cmd,
+		        image._vkImage,
+		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_TRANSFER_BIT, .access = VK_ACCESS_2_TRANSFER_READ_BIT},
+		        vkutil::StageAccess{.stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT},
+		        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		        image.getImageLayout(),
+		        range
+		);
+
+		return submitReadback(cmd, wrapper, region, storageSize, std::move(callback));
+	}
+	StagingDevice::MemoryRegionDesc StagingDevice::getReadbackRegion(uint32_t size) {
+		const uint32_t alignedSize = vkutil::GetAlignedSize(size, kStagingBufferAlignment);
+		ensureStagingBufferSize(alignedSize);
+		ASSERT_MSG(alignedSize <= _stagingBufferSize, "Readback is larger than the staging buffer maximum!");
+		MemoryRegionDesc region = getNextFreeOffset(size);
+		// a region cut short by the end of the ring goes straight back, the next one starts at the front
+		while (region.size_ < alignedSize) {
+			commitRegion(region);
+			region = getNextFreeOffset(size);
+		}
+		return region;
+	}
+	uint32_t StagingDevice::submitReadback(VkCommandBuffer cmd, const ImmediateCommands::CommandBufferWrapper* wrapper, MemoryRegionDesc region, uint32_t size, ReadbackCallback&& callback) {
+		// the copy has to be visible to the host once the submit retired
+		const VkMemoryBarrier2 barrier = {
+		    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		    .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+		    .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+		};
+		const VkDependencyInfo dependencyInfo = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &barrier};
+		vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+		region.handle_ = wrapper ? _queue.submit(*wrapper) : SubmitHandle();
+		region.state_ = MemoryRegionDesc::State::Readback;
+		commitRegion(region);
+
+		const uint32_t id = _nextReadbackId++;
+		// skip 0 when wrapping around, it is the empty ticket
+		if (!_nextReadbackId)
+			_nextReadbackId++;
+		_fences.back().readbackId_ = id;
+		_readbacks.push_back({
+		    .id_ = id,
+		    .offset_ = region.offset_,
+		    .size_ = size,
+		    .handle_ = region.handle_,
+		    .awaitingSubmit_ = wrapper == nullptr,
+		    .callback_ = std::move(callback),
+		});
+		return id;
+	}
+	bool StagingDevice::isReadbackReady(const PendingReadback& readback) const {
+		return readback.isEvicted_ || (!readback.awaitingSubmit_ && _queue.isReady(readback.handle_));
+	}
+	bool StagingDevice::isReadbackReady(uint32_t id) const {
+		const auto it = std::ranges::find(_readbacks, id, &PendingReadback::id_);
+		return it != _readbacks.end() && isReadbackReady(*it);
+	}
+	std::span<const uint8_t> StagingDevice::getReadbackData(const PendingReadback& readback) const {
+		if (readback.isEvicted_)
+			return readback.evicted_;
+		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
+		ASSERT(stagingBuffer);
+		if (!stagingBuffer->_isCoherentMemory) {
+			stagingBuffer->invalidateMappedMemory(_ctx, readback.offset_, readback.size_);
+		}
+		return {stagingBuffer->getMappedPtr() + readback.offset_, readback.size_};
+	}
+	bool StagingDevice::fetchReadback(uint32_t id, void* outData, size_t size) {
+		const auto it = std::ranges::find(_readbacks, id, &PendingReadback::id_);
+		if (it == _readbacks.end()) {
+			LOG_SYSTEM(LogType::Warning, "Readback was already consumed or never requested!");
+			return false;
+		}
+		if (!isReadbackReady(*it))
+			return false;
+		const std::span<const uint8_t> data = getReadbackData(*it);
+		memcpy(outData, data.data(), std::min(size, data.size()));
+		releaseReadback(id);
+		return true;
+	}
+	void StagingDevice::processReadbacks() {
+		for (size_t i = 0; i < _readbacks.size();) {
+			PendingReadback& readback = _readbacks[i];
+			if (!readback.callback_ || !isReadbackReady(readback)) {
+				i++;
+				continue;
+			}
+			// the callback may request new readbacks, so nothing may point into _readbacks while it runs
+			// the ring space, or the heap copy, stays put until the release below
+			const uint32_t id = readback.id_;
+			const ReadbackCallback callback = std::move(readback.callback_);
+			callback(getReadbackData(readback));
+			releaseReadback(id);
+		}
+	}
+	void StagingDevice::releaseReadback(uint32_t id) {
+		const auto it = std::ranges::find(_readbacks, id, &PendingReadback::id_);
+		ASSERT(it != _readbacks.end());
+		if (!it->isEvicted_) {
+			for (size_t i = _firstFence; i < _fences.size(); ++i) {
+				RingFence& fence = _fences[i];
+				if (fence.readbackId_ != id)
+					continue;
+				fence.state_ = MemoryRegionDesc::State::Free;
+				fence.readbackId_ = 0;
+				break;
+			}
+		}
+		_readbacks.erase(it);
 	}
+	void StagingDevice::evictReadback(RingFence& fence) {
+		const auto it = std::ranges::find(_readbacks, fence.readbackId_, &PendingReadback::id_);
+		ASSERT(it != _readbacks.end());
+		ASSERT_MSG(!it->awaitingSubmit_, "Cannot reset the staging ring while a readback's command buffer is pending. Submit or abandon the command buffer first.");
+		_queue.wait(it->handle_);
+		const std::span<const uint8_t> data = getReadbackData(*it);
+		it->evicted_.assign(data.begin(), data.end());
+		it->isEvicted_ = true;
+		fence.state_ = MemoryRegionDesc::State::Free;
+		fence.readbackId_ = 0;
+	}
+
 	void StagingDevice::getImageData(AllocatedTexture& image, const VkOffset3D& offset, const VkExtent3D& extent, VkImageSubresourceRange range, VkFormat format, void* outData) {
 		ASSERT(image.getImageLayout() != VK_IMAGE_LAYOUT_UNDEFINED);
 		ASSERT(range.layerCount == 1);
+		// reading back has to see anything still sitting in an open upload batch
+		if (_isBatching)
+			submitBatch();
 
 		const uint32_t storageSize = extent.width * extent.height * extent.depth * vkutil::GetBytesPerPixel(format);
 
@@ -382,7 +821,7 @@ namespace mythril {
 
 		AllocatedBuffer* stagingBuffer = _ctx._bufferPool.get(_stagingBuffer);
 
-		const ImmediateCommands::CommandBufferWrapper& wrapper1 = _ctx._immGraphics->acquire();
+		const ImmediateCommands::CommandBufferWrapper& wrapper1 = _queue.acquire();
 
 		// 1. Transition to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
 		vkutil::ImageMemoryBarrier2(
@@ -412,11 +851,11 @@ namespace mythril {
 		};
 		vkCmdCopyImageToBuffer(wrapper1._cmdBuf, image._vkImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer->_vkBuffer, 1, &copy);
 
-		desc.handle_ = _ctx._immGraphics->submit(wrapper1);
+		desc.handle_ = _queue.submit(wrapper1);
 		desc.state_ = MemoryRegionDesc::State::Busy;
-		_regions.push_back(desc);
+		commitRegion(desc);
 
-		waitAndReset();
+		_queue.wait(desc.handle_);
 
 		if (!stagingBuffer->_isCoherentMemory) {
 			stagingBuffer->invalidateMappedMemory(_ctx, desc.offset_, desc.size_);
@@ -426,7 +865,7 @@ namespace mythril {
 		memcpy(outData, stagingBuffer->getMappedPtr() + desc.offset_, storageSize);
 
 		// 4. Transition back to the initial image layout
-		const ImmediateCommands::CommandBufferWrapper& wrapper2 = _ctx._immGraphics->acquire();
+		const ImmediateCommands::CommandBufferWrapper& wrapper2 = _queue.acquire();
 
 		vkutil::ImageMemoryBarrier2(
 		        wrapper2._cmdBuf,
@@ -438,7 +877,7 @@ namespace mythril {
 		        range
 		);
 
-		_ctx._immGraphics->wait(_ctx._immGraphics->submit(wrapper2));
+		_queue.wait(_queue.submit(wrapper2));
 	}
 
 	void StagingDevice::ensureStagingBufferSize(uint32_t sizeNeeded) {
@@ -472,14 +911,11 @@ namespace mythril {
 		}
 
 		ASSERT(!_stagingBuffer.empty());
-
-		_regions.clear();
-		_regions.push_back({0, _stagingBufferSize, SubmitHandle(), MemoryRegionDesc::State::Free});
 	}
-	bool StagingDevice::isRegionFree(const MemoryRegionDesc& region) const {
-		if (region.state_ == MemoryRegionDesc::State::Free)
+	bool StagingDevice::isRegionFree(const RingFence& fence) const {
+		if (fence.state_ == MemoryRegionDesc::State::Free)
 			return true;
-		if (region.state_ == MemoryRegionDesc::State::Busy && _ctx._immGraphics->isReady(region.handle_))
+		if (fence.state_ == MemoryRegionDesc::State::Busy && _queue.isReady(fence.handle_))
 			return true;
 		return false;
 	}
@@ -487,77 +923,97 @@ namespace mythril {
 	StagingDevice::MemoryRegionDesc StagingDevice::getNextFreeOffset(uint32_t size) {
 		const uint32_t requestedAlignedSize = vkutil::GetAlignedSize(size, kStagingBufferAlignment);
 		ensureStagingBufferSize(requestedAlignedSize);
+		retireRegions();
 
-		ASSERT(!_regions.empty());
-
-		// if we can't find an available region that is big enough to store requestedAlignedSize, return whatever we could find, which will be
-		// stored in bestNextIt
-		auto bestNextIt = _regions.begin();
-
-		for (auto it = _regions.begin(); it != _regions.end(); ++it) {
-			if (isRegionFree(*it)) {
-				// This region is free, but is it big enough?
-				if (it->size_ >= requestedAlignedSize) {
-					// It is big enough!
-					const uint32_t unusedSize = it->size_ - requestedAlignedSize;
-					const uint32_t unusedOffset = it->offset_ + requestedAlignedSize;
-
-					// Prepare return value
-					const auto result = MemoryRegionDesc{it->offset_, requestedAlignedSize, SubmitHandle(), MemoryRegionDesc::State::Free};
-
-					// Perform the cleanup that was in SCOPE_EXIT
-					_regions.erase(it);
-					if (unusedSize > 0) {
-						_regions.insert(_regions.begin(), {unusedOffset, unusedSize, SubmitHandle(), MemoryRegionDesc::State::Free});
-					}
-
-					return result;
-				}
-
-				// Cache the largest available region that isn't as big as the one we're looking for
-				if (it->size_ > bestNextIt->size_) {
-					bestNextIt = it;
-				}
+		while (true) {
+			// an empty ring starts over at the front, which gives the largest contiguous region
+			if (_ringUsed == 0) {
+				_ringHead = 0;
+				_ringTail = 0;
 			}
-		}
-		// we found a region that is available that is smaller than the requested size. It's the best we can do
-		// we found a region that is available that is smaller than the requested size. It's the best we can do
-		if (bestNextIt != _regions.end() && isRegionFree(*bestNextIt)) {
-			const auto result = MemoryRegionDesc{bestNextIt->offset_, bestNextIt->size_, SubmitHandle(), MemoryRegionDesc::State::Free};
-			// Perform the cleanup that was in SCOPE_EXIT
-			_regions.erase(bestNextIt);
+			// free bytes are [head, end) and [0, tail) while the head is ahead of the tail, [head, tail) once it wrapped
+			const bool headAhead = _ringUsed == 0 || _ringHead > _ringTail;
+			const uint32_t endSpace = headAhead ? _stagingBufferSize - _ringHead : _ringTail - _ringHead;
+			const uint32_t frontSpace = headAhead && _ringUsed > 0 ? _ringTail : 0;
+			// skipping the end of the ring only pays off if the front holds more of the request
+			const bool wrap = endSpace < requestedAlignedSize && frontSpace > endSpace;
+			const uint32_t available = wrap ? frontSpace : endSpace;
+			if (available == 0) {
+				// full, the oldest upload is the first one that can make room
+				popOldestFence();
+				continue;
+			}
+			const MemoryRegionDesc result = {
+			    .offset_ = wrap ? 0 : _ringHead,
+			    .size_ = std::min(requestedAlignedSize, available),
+			    .handle_ = SubmitHandle(),
+			    .state_ = MemoryRegionDesc::State::Free,
+			    .padding_ = wrap ? _stagingBufferSize - _ringHead : 0,
+			};
+			_ringHead = result.offset_ + result.size_;
+			if (_ringHead == _stagingBufferSize)
+				_ringHead = 0;
+			_ringUsed += result.size_ + result.padding_;
 			return result;
 		}
-		// nothing was available. Let's wait for the entire staging buffer to become free
-		waitAndReset();
-
-		// waitAndReset() adds a region that spans the entire buffer. Since we'll be using part of it, we need to replace it with a used block and
-		// an unused portion
-		_regions.clear();
-		// store the unused size in the deque first...
-		const uint32_t unusedSize = _stagingBufferSize > requestedAlignedSize ? _stagingBufferSize - requestedAlignedSize : 0;
-
-		if (unusedSize) {
-			const uint32_t unusedOffset = _stagingBufferSize - unusedSize;
-			_regions.insert(_regions.begin(), {unusedOffset, unusedSize, SubmitHandle(), MemoryRegionDesc::State::Free});
-		}
-		// ...and then return the smallest free region that can hold the requested size
-		return {
-		    .offset_ = 0,
-		    .size_ = _stagingBufferSize - unusedSize,
-		    .handle_ = SubmitHandle(),
-		    .state_ = MemoryRegionDesc::State::Free,
-		};
+	}
+	void StagingDevice::commitRegion(const MemoryRegionDesc& region) {
+		const uint32_t end = region.offset_ + region.size_;
+		if (_firstFence < _fences.size()) {
+			RingFence& newest = _fences.back();
+			if (region.state_ != MemoryRegionDesc::State::Readback && newest.state_ == region.state_ && newest.handle_.handle() == region.handle_.handle()) {
+				newest.end_ = end;
+				newest.size_ += region.size_ + region.padding_;
+				return;
+			}
+		}
+		_fences.push_back({.end_ = end, .size_ = region.size_ + region.padding_, .handle_ = region.handle_, .state_ = region.state_});
+	}
+	void StagingDevice::retireRegions() {
+		while (_firstFence < _fences.size() && isRegionFree(_fences[_firstFence]))
+			popOldestFence();
+	}
+	void StagingDevice::popOldestFence() {
+		ASSERT_MSG(_firstFence < _fences.size(), "StagingDevice ring is full without any upload in flight!");
+		RingFence& oldest = _fences[_firstFence];
+		// a batch holding the ring up gets submitted early, the batch itself stays open
+		if (oldest.state_ == MemoryRegionDesc::State::Batched)
+			submitBatch();
+		// an unconsumed readback moves to the heap, this is the only place a readback waits
+		if (oldest.state_ == MemoryRegionDesc::State::Readback)
+			evictReadback(oldest);
+		ASSERT_MSG(oldest.state_ != MemoryRegionDesc::State::Pending, "Cannot reset the staging ring while graph upload regions are pending. Submit or abandon the command buffer first.");
+		if (oldest.state_ == MemoryRegionDesc::State::Busy)
+			_queue.wait(oldest.handle_);
+		_ringTail = oldest.end_ == _stagingBufferSize ? 0 : oldest.end_;
+		_ringUsed -= oldest.size_;
+		// compacting only once most of the vector is retired keeps popping O(1) amortized
+		if (++_firstFence == _fences.size()) {
+			_fences.clear();
+			_firstFence = 0;
+		} else if (_firstFence > 64 && _firstFence * 2 > _fences.size()) {
+			_fences.erase(_fences.begin(), _fences.begin() + static_cast<std::ptrdiff_t>(_firstFence));
+			_firstFence = 0;
+		}
 	}
 	void StagingDevice::waitAndReset() {
-		for (const MemoryRegionDesc& r: _regions) {
-			ASSERT_MSG(r.state_ != MemoryRegionDesc::State::Pending, "Cannot reset the staging ring while graph upload regions are pending. Submit or abandon the command buffer first.");
-			if (r.state_ == MemoryRegionDesc::State::Busy) {
-				_ctx._immGraphics->wait(r.handle_);
+		if (_isBatching)
+			submitBatch();
+		for (size_t i = _firstFence; i < _fences.size(); ++i) {
+			RingFence& fence = _fences[i];
+			ASSERT_MSG(fence.state_ != MemoryRegionDesc::State::Pending, "Cannot reset the staging ring while graph upload regions are pending. Submit or abandon the command buffer first.");
+			if (fence.state_ == MemoryRegionDesc::State::Readback) {
+				evictReadback(fence);
+			}
+			if (fence.state_ == MemoryRegionDesc::State::Busy) {
+				_queue.wait(fence.handle_);
 			}
 		}
-		_regions.clear();
-		_regions.push_back({0, _stagingBufferSize, SubmitHandle(), MemoryRegionDesc::State::Free});
+		_fences.clear();
+		_firstFence = 0;
+		_ringHead = 0;
+		_ringTail = 0;
+		_ringUsed = 0;
 	}
 
 } // namespace mythril
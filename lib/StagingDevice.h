@@ -6,10 +6,14 @@
 
 
 #include "mythril/ObjectHandles.h"
+#include "ImmediateCommands.h"
 #include "SubmitHandle.h"
+#include "faststl/FrameArena.h"
 
 #include <cstdint>
+#include <functional>
 #include <span>
+#include <unordered_map>
 #include <vector>
 
 #include <volk.h>
@@ -23,7 +27,9 @@ namespace mythril {
 
 	class StagingDevice final {
 	public:
-		explicit StagingDevice(CTX& ctx);
+		// uploads are recorded on queue, with a releaseFamily every upload ends in a release to that family
+		// and its acquire half is held until recordAcquires
+		StagingDevice(CTX& ctx, ImmediateCommands& queue, uint32_t releaseFamily = VK_QUEUE_FAMILY_IGNORED);
 		~StagingDevice() = default;
 
 		StagingDevice(const StagingDevice&) = delete;
@@ -38,10 +44,34 @@ namespace mythril {
 			VkBuffer dstBuffer = VK_NULL_HANDLE;
 			VkDeviceSize dstOffset = 0;
 		};
-		std::vector<StagedBufferCopy> stageBufferCopy(AllocatedBuffer& buffer, const void* data, size_t size, size_t dstOffset);
+		// the copies live in the frame arena, record them before the frame is submitted
+		ArenaVector<StagedBufferCopy> stageBufferCopy(AllocatedBuffer& buffer, const void* data, size_t size, size_t dstOffset);
 		void recordBufferCopies(VkCommandBuffer cmd, std::span<const StagedBufferCopy> copies);
 		void onGraphSubmit(SubmitHandle submit);
 		void resetPending();
+		// while batching, uploads only stage their data and copies, submitBatch records all of them into one command buffer
+		// with one barrier before and one after the copies. batching stays on until endBatch
+		void beginBatch();
+		SubmitHandle submitBatch();
+		SubmitHandle endBatch();
+		bool isBatching() const { return _isBatching; }
+		// records the acquires of every upload whose submit signalled the queue timeline with at most upToValue
+		// returns the highest value covered, the consumer has to wait on it before the barriers execute. 0 when there was nothing
+		uint64_t recordAcquires(VkCommandBuffer cmd, uint64_t upToValue);
+
+		using ReadbackCallback = std::function<void(std::span<const uint8_t>)>;
+		// a readback keeps its ring space until it was fetched or its callback ran, if the ring fills up first the oldest ones
+		// are moved into heap memory. with a cmd the copy is recorded into it and retires with its graph submit, otherwise it is
+		// submitted right away. returns the id to poll with, never 0
+		uint32_t requestBufferReadback(VkCommandBuffer cmd, AllocatedBuffer& buffer, size_t offset, size_t size, ReadbackCallback&& callback);
+		uint32_t requestImageReadback(
+		        VkCommandBuffer cmd, AllocatedTexture& image, const VkOffset3D& offset, const VkExtent3D& extent, VkImageSubresourceRange range, VkFormat format, ReadbackCallback&& callback
+		);
+		bool isReadbackReady(uint32_t id) const;
+		// copies the result out and releases it, false while the copy is still in flight
+		bool fetchReadback(uint32_t id, void* outData, size_t size);
+		// hands every retired readback with a callback to it, never waits
+		void processReadbacks();
 		void
 		imageData2D(AllocatedTexture& image, const VkRect2D& imageRegion, uint32_t baseMipLevel, uint32_t numMipLevels, uint32_t layerCheck, uint32_t numLayers, VkFormat format, const void* data);
 		void imageData3D(AllocatedTexture& image, const VkOffset3D& offset, const VkExtent3D& extent, VkFormat format, const void* data);
@@ -49,30 +79,136 @@ namespace mythril {
 
 	private:
 		static constexpr int kStagingBufferAlignment = 16;
+		// how many pieces of an upload larger than the ring can be in flight at once
+		static constexpr uint32_t kNumStreamingChunks = 4;
 		struct MemoryRegionDesc {
 			enum class State : uint8_t {
 				Free,
 				Pending,
-				Busy
+				// staged by an upload batch that wasnt submitted yet
+				Batched,
+				Busy,
+				// holds a readback result, only freed once it was consumed
+				Readback
 			};
 			uint32_t offset_ = 0;
 			uint32_t size_ = 0;
 			SubmitHandle handle_ = {};
 			State state_ = State::Free;
+			// bytes at the end of the ring that were skipped to fit the region at the front, released together with it
+			uint32_t padding_ = 0;
+		};
+		// everything taken from the ring up to end_ until handle_ is ready, consecutive regions of one submit share a fence
+		// so a frame of uploads costs a single fence no matter how many copies it has
+		struct RingFence {
+			uint32_t end_ = 0;
+			uint32_t size_ = 0;
+			SubmitHandle handle_ = {};
+			MemoryRegionDesc::State state_ = MemoryRegionDesc::State::Free;
+			// readbacks are released one by one, so their fences never merge
+			uint32_t readbackId_ = 0;
+		};
+		struct PendingReadback {
+			uint32_t id_ = 0;
+			uint32_t offset_ = 0;
+			uint32_t size_ = 0;
+			SubmitHandle handle_ = {};
+			// recorded into a graph command buffer that wasnt submitted yet
+			bool awaitingSubmit_ = false;
+			bool isEvicted_ = false;
+			// where the result went when the ring needed its space back
+			std::vector<uint8_t> evicted_;
+			ReadbackCallback callback_;
 		};
+		// a readback needs all of its bytes in one contiguous region
+		MemoryRegionDesc getReadbackRegion(uint32_t size);
+		uint32_t submitReadback(VkCommandBuffer cmd, const ImmediateCommands::CommandBufferWrapper* wrapper, MemoryRegionDesc region, uint32_t size, ReadbackCallback&& callback);
+		bool isReadbackReady(const PendingReadback& readback) const;
+		std::span<const uint8_t> getReadbackData(const PendingReadback& readback) const;
+		void releaseReadback(uint32_t id);
+		void evictReadback(RingFence& fence);
 
+		// copies into one destination, recorded with a single copy call and covered by a single barrier
+		struct BufferUpload {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkBufferUsageFlags usage = 0;
+			VkDeviceSize begin = VK_WHOLE_SIZE;
+			VkDeviceSize end = 0;
+			std::vector<VkBufferCopy> regions;
+		};
+		struct ImageUpload {
+			VkImage image = VK_NULL_HANDLE;
+			VkImageSubresourceRange range = {};
+			std::vector<VkBufferImageCopy> regions;
+			// an upload streamed in several chunks only transitions into TRANSFER_DST with its first one
+			// and out of it with its last, the chunks in between only copy
+			bool isFirst = true;
+			bool isLast = true;
+		};
+		// one box of tightly packed texels within a single subresource
+		struct ImageBox {
+			VkImageSubresourceLayers subresource = {};
+			VkOffset3D offset = {};
+			VkExtent3D extent = {};
+			// bytes of one row of blocks, and the number of those per depth slice
+			uint32_t rowBytes = 0;
+			uint32_t numRows = 0;
+			uint32_t blockHeight = 1;
+			const uint8_t* data = nullptr;
+		};
+		// copies the boxes through the ring in as many chunks as it takes, whole boxes first, then depth slices, then rows
+		// a chunk is submitted as soon as it is full, so it is copied while the next one is still being filled
+		void streamImage(AllocatedTexture& image, const VkImageSubresourceRange& range, std::span<const ImageBox> boxes);
+		struct PendingAcquire {
+			uint64_t value = 0;
+			std::vector<VkBufferMemoryBarrier2> buffers;
+			std::vector<VkImageMemoryBarrier2> images;
+		};
+		void recordUploads(VkCommandBuffer cmd, std::span<const BufferUpload> buffers, std::span<const ImageUpload> images, PendingAcquire* acquire) const;
+		SubmitHandle submitUploads(std::span<const BufferUpload> buffers, std::span<const ImageUpload> images);
+		// submit the copy right away, or queue it into the open batch, and commit the region it was staged in
+		void uploadBuffer(AllocatedBuffer& buffer, MemoryRegionDesc region, const VkBufferCopy& copy);
+		void uploadImage(AllocatedTexture& image, MemoryRegionDesc region, ImageUpload&& upload);
+
+		// bumps the ring head, returns the largest contiguous region up to size and only waits when the ring is full
 		MemoryRegionDesc getNextFreeOffset(uint32_t size);
+		// every region from getNextFreeOffset has to come back through here, in the order they were handed out
+		void commitRegion(const MemoryRegionDesc& region);
 		void ensureStagingBufferSize(uint32_t sizeNeeded);
 		void waitAndReset();
-		bool isRegionFree(const MemoryRegionDesc& region) const;
+		void retireRegions();
+		void popOldestFence();
+		bool isRegionFree(const RingFence& fence) const;
 
 	private:
 		CTX& _ctx;
+		ImmediateCommands& _queue;
+		uint32_t _releaseFamily = VK_QUEUE_FAMILY_IGNORED;
 
 		uint32_t _stagingBufferSize = 0;
 		uint32_t _stagingBufferCounter = 0;
 		uint32_t _maxBufferSize = 0;
 		const uint32_t _minBufferSize = 4u * 2048u * 2048u;
-		std::vector<MemoryRegionDesc> _regions;
+		// ring over the staging buffer, bytes between tail and head are in flight
+		uint32_t _ringHead = 0;
+		uint32_t _ringTail = 0;
+		uint32_t _ringUsed = 0;
+		// oldest first, popped by advancing _firstFence so a warm ring never reallocates
+		std::vector<RingFence> _fences;
+		size_t _firstFence = 0;
+
+		bool _isBatching = false;
+		// the last submit of the open batch, anything it recorded earlier is done once this is
+		SubmitHandle _batchSubmit = {};
+		std::vector<BufferUpload> _batchedBuffers;
+		std::unordered_map<VkBuffer, uint32_t> _batchedBufferIndices;
+		std::vector<ImageUpload> _batchedImages;
+
+		// released uploads waiting for the other family to acquire them, oldest first
+		std::vector<PendingAcquire> _pendingAcquires;
+
+		// sorted by id
+		std::vector<PendingReadback> _readbacks;
+		uint32_t _nextReadbackId = 1;
 	};
 } // namespace mythril
@@ -22,4 +22,14 @@ namespace mythril {
 		bool empty() const { return submitId_ == 0; }
 		uint64_t handle() const { return (static_cast<uint64_t>(submitId_) << 32) + bufferIndex_; }
 	};
+	// an upload on the transfer queue, the value its submit signals on that queue's timeline
+	struct UploadTicket {
+		uint64_t value_ = 0;
+		bool empty() const { return value_ == 0; }
+	};
+	// a copy in the readback ring, valid until its result was fetched or handed to its callback
+	struct ReadbackTicket {
+		uint32_t id_ = 0;
+		bool empty() const { return id_ == 0; }
+	};
 } // namespace mythril
@@ -35,6 +35,8 @@ namespace mythril {
 		[[nodiscard]] bool isAttachment() const { return (_vkUsageFlags & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) > 0; }
 		[[nodiscard]] bool isDepthAttachment() const { return (_vkUsageFlags & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) > 0; }
 		[[nodiscard]] bool isSwapchainImage() const { return _isSwapchainImage; }
+		// memory comes from a RenderGraph, only valid to use after that graph has compiled
+		[[nodiscard]] bool isTransient() const { return _isTransient; }
 
 		[[nodiscard]] bool hasMipmaps() const { return _numLevels > 1; }
 		[[nodiscard]] uint32_t getNumMips() const { return _numLevels; }
@@ -111,6 +113,7 @@ namespace mythril {
 		bool _isResolveAttachment = false;
 		bool _isSwapchainImage = false;
 		bool _isOwning = true;
+		bool _isTransient = false;
 		char _debugName[kMaxDebugNameLength] = {0};
 
 		friend class CTX;
@@ -0,0 +1,72 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+#include "WorkerPool.h"
+
+#include "mythril/CTX.h"
+
+namespace mythril {
+	WorkerPool::WorkerPool(uint32_t numWorkers) {
+		_threads.reserve(numWorkers);
+		// thread 0 is whoever calls dispatch()
+		for (uint32_t i = 0; i < numWorkers; i++) {
+			_threads.emplace_back(&WorkerPool::workerLoop, this, i + 1);
+		}
+	}
+	WorkerPool::~WorkerPool() {
+		{
+			std::lock_guard lock(_mutex);
+			_quit = true;
+		}
+		_wakeCondition.notify_all();
+		for (std::thread& thread: _threads) {
+			thread.join();
+		}
+	}
+
+	void WorkerPool::dispatch(uint32_t numTasks, const std::function<void(uint32_t, uint32_t)>& fn) {
+		MYTH_PROFILER_FUNCTION();
+		if (numTasks == 0)
+			return;
+		{
+			std::lock_guard lock(_mutex);
+			_job = &fn;
+			_numTasks = numTasks;
+			_nextTask.store(0, std::memory_order_relaxed);
+			_numBusyWorkers = static_cast<uint32_t>(_threads.size());
+			_generation++;
+		}
+		_wakeCondition.notify_all();
+		drain(0);
+
+		std::unique_lock lock(_mutex);
+		_doneCondition.wait(lock, [this] { return _numBusyWorkers == 0; });
+		_job = nullptr;
+	}
+
+	void WorkerPool::workerLoop(uint32_t threadIdx) {
+		uint64_t seenGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock lock(_mutex);
+				_wakeCondition.wait(lock, [&] { return _quit || _generation != seenGeneration; });
+				if (_quit)
+					return;
+				seenGeneration = _generation;
+			}
+			drain(threadIdx);
+			{
+				std::lock_guard lock(_mutex);
+				if (--_numBusyWorkers == 0)
+					_doneCondition.notify_one();
+			}
+		}
+	}
+
+	void WorkerPool::drain(uint32_t threadIdx) {
+		uint32_t task;
+		while ((task = _nextTask.fetch_add(1, std::memory_order_relaxed)) < _numTasks) {
+			(*_job)(task, threadIdx);
+		}
+	}
+} // namespace mythril
@@ -0,0 +1,49 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mythril {
+	// small persistent pool for fanning out command recording, the calling thread joins in as thread 0
+	class WorkerPool final {
+	public:
+		explicit WorkerPool(uint32_t numWorkers);
+		~WorkerPool();
+
+		// disallow copy and assignment
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		// runs fn(taskIdx, threadIdx) for every task and only returns once all of them finished
+		// threadIdx is stable for the duration of a task and always < getNumThreads()
+		void dispatch(uint32_t numTasks, const std::function<void(uint32_t, uint32_t)>& fn);
+		uint32_t getNumThreads() const { return static_cast<uint32_t>(_threads.size()) + 1; }
+
+	private:
+		void workerLoop(uint32_t threadIdx);
+		void drain(uint32_t threadIdx);
+
+	private:
+		std::vector<std::thread> _threads;
+
+		std::mutex _mutex;
+		std::condition_variable _wakeCondition;
+		std::condition_variable _doneCondition;
+
+		const std::function<void(uint32_t, uint32_t)>* _job = nullptr;
+		std::atomic<uint32_t> _nextTask = 0;
+		uint32_t _numTasks = 0;
+		uint32_t _numBusyWorkers = 0;
+		uint64_t _generation = 0;
+		bool _quit = false;
+	};
+} // namespace mythril
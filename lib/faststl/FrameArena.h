@@ -0,0 +1,118 @@
+//
+// Created by Hayden Rivas on 10/16/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace mythril {
+	// LinearArena is a bump allocator for scratch memory that only has to live until the arena is reset
+	// deallocation is a no-op, everything is released at once by reset()
+	// not thread safe, only the thread that owns the arena may allocate from it
+	class LinearArena {
+	public:
+		static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+		LinearArena() = default;
+		~LinearArena() = default;
+
+		// disallow copy, moving is fine as handed out pointers stay in their block
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+		LinearArena(LinearArena&&) noexcept = default;
+		LinearArena& operator=(LinearArena&&) noexcept = default;
+
+		void* allocate(size_t size, size_t alignment) {
+			while (_currentBlock < _blocks.size()) {
+				Block& block = _blocks[_currentBlock];
+				// new[] only guarantees the default alignment, so the address is aligned rather than the offset
+				const auto base = reinterpret_cast<uintptr_t>(block.data.get());
+				const size_t alignedOffset = ((base + _offset + alignment - 1) & ~(alignment - 1)) - base;
+				if (alignedOffset + size <= block.size) {
+					_offset = alignedOffset + size;
+					_numBytesUsed += size;
+					return block.data.get() + alignedOffset;
+				}
+				// retired blocks are only freed on reset, anything handed out from them stays valid
+				_currentBlock++;
+				_offset = 0;
+			}
+			const size_t blockSize = std::max(kDefaultBlockSize, size + alignment);
+			_blocks.push_back({std::make_unique<std::byte[]>(blockSize), blockSize});
+			_offset = 0;
+			return allocate(size, alignment);
+		}
+		// once a frame grew past the first block they are merged, so a warm arena never touches the heap again
+		void reset() {
+			if (_blocks.size() > 1) {
+				size_t totalSize = 0;
+				for (const Block& block: _blocks)
+					totalSize += block.size;
+				_blocks.clear();
+				_blocks.push_back({std::make_unique<std::byte[]>(totalSize), totalSize});
+			}
+			_peakBytesUsed = std::max(_peakBytesUsed, _numBytesUsed);
+			_numBytesUsed = 0;
+			_currentBlock = 0;
+			_offset = 0;
+		}
+
+		size_t getNumBytesUsed() const { return _numBytesUsed; }
+		size_t getPeakBytesUsed() const { return std::max(_peakBytesUsed, _numBytesUsed); }
+
+	private:
+		struct Block {
+			std::unique_ptr<std::byte[]> data;
+			size_t size = 0;
+		};
+		std::vector<Block> _blocks;
+		size_t _currentBlock = 0;
+		size_t _offset = 0;
+		size_t _numBytesUsed = 0;
+		size_t _peakBytesUsed = 0;
+	};
+
+	// std compatible allocator drawing from a LinearArena, without an arena it falls back to the global heap
+	// that way the same container type works for both per-frame scratch and long lived storage
+	template<typename T>
+	class ArenaAllocator {
+	public:
+		using value_type = T;
+
+		ArenaAllocator() noexcept = default;
+		ArenaAllocator(LinearArena& arena) noexcept :
+		    _arena(&arena) {}
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) noexcept :
+		    _arena(other.getArena()) {}
+
+		T* allocate(size_t n) {
+			if (_arena)
+				return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+		}
+		void deallocate(T* ptr, size_t n) noexcept {
+			if (!_arena)
+				::operator delete(ptr, n * sizeof(T), std::align_val_t(alignof(T)));
+		}
+
+		LinearArena* getArena() const noexcept { return _arena; }
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const noexcept { return _arena == other.getArena(); }
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const noexcept { return _arena != other.getArena(); }
+
+	private:
+		LinearArena* _arena = nullptr;
+	};
+
+	template<typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+} // namespace mythril
@@ -162,6 +162,13 @@ namespace mythril::vkutil {
 		ASSERT_MSG(props, "Unknown VkFormat: {}", static_cast<int>(format));
 		return props->numPlanes;
 	}
+	uint32_t GetTextureBlockHeight(VkFormat format) {
+		const TextureFormatProperties* props = GetFormatProperties(format);
+		ASSERT_MSG(props, "Unknown VkFormat: {}", static_cast<int>(format));
+		if (props->numPlanes > 1)
+			return 1;
+		return std::max<uint32_t>(props->blockHeight, 1);
+	}
 	uint32_t GetPixelFormat(VkFormat format) {
 		const TextureFormatProperties* props = GetFormatProperties(format);
 		ASSERT_MSG(props, "Unknown VkFormat: {}", static_cast<int>(format));
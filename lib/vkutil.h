@@ -16,6 +16,8 @@ namespace mythril::vkutil {
 	uint32_t GetTextureBytesPerLayer(uint32_t width, uint32_t height, VkFormat format, uint32_t level);
 	uint32_t GetBytesPerPixel(VkFormat format);
 	uint32_t GetNumImagePlanes(VkFormat format);
+	// height in texels of one row of blocks, planes of multi-planar formats are addressed per texel
+	uint32_t GetTextureBlockHeight(VkFormat format);
 	VkExtent2D GetImagePlaneExtent(VkExtent2D plane0, VkFormat format, uint32_t plane);
 
 